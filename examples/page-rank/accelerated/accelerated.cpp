@@ -1,100 +1,311 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <string>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <CL/cl.h>
 
+#include "../common/checkpoint.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "../common/reorder.h"
+
 using namespace std;
 using namespace std::chrono;
 
 const double DAMPING = 0.85;
 
+// Layout of the device-side step state, mirrored in the kernel source
+const int PENDING_SHARE = 0;
+const int RESIDUAL = 1;
+const int SUPERSTEPS = 2;
+const int HALTED = 3;
+const int STEP = 4;
+const int STEP_STATE_SIZE = 5;
+
+const size_t WORK_GROUP_SIZE = 256;
+// In-degree from which the pull mode gives a vertex a whole work-group
+const int HEAVY_IN_DEGREE = 256;
+
+struct KernelLaunch {
+    cl_kernel kernel;
+    size_t globalSize;
+    size_t localSize;
+};
+
 const char* kernelSource = R"(
+// Ranks and messages are stored as Rank, sums are carried in Accumulator,
+// which is double unless the device has no fp64 support (set by the host
+// through RANK_DOUBLE / ACCUMULATOR_DOUBLE)
+#if ACCUMULATOR_DOUBLE
 #pragma OPENCL EXTENSION cl_khr_fp64 : enable
-#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+typedef double Accumulator;
+#else
+typedef float Accumulator;
+#endif
 
-inline void atomic_add_double(__global double* addr, double val) {
+#if RANK_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+typedef double Rank;
+typedef unsigned long RankBits;
+#define rank_cmpxchg atom_cmpxchg
+#else
+typedef float Rank;
+typedef unsigned int RankBits;
+#define rank_cmpxchg atomic_cmpxchg
+#endif
+
+inline void atomic_add_rank(__global Rank* addr, Rank val) {
     union {
-        unsigned long u64;
-        double f64;
+        RankBits bits;
+        Rank value;
     } old_val, new_val;
     
     do {
-        old_val.f64 = *addr;
-        new_val.f64 = old_val.f64 + val;
-    } while (atom_cmpxchg((__global unsigned long*)addr, old_val.u64, new_val.u64) != old_val.u64);
+        old_val.value = *addr;
+        new_val.value = old_val.value + val;
+    } while (rank_cmpxchg((volatile __global RankBits*)addr, old_val.bits, new_val.bits) != old_val.bits);
+}
+
+// Per-step scalars kept on the device so supersteps need no host round trip
+#define PENDING_SHARE 0
+#define RESIDUAL 1
+#define SUPERSTEPS 2
+#define HALTED 3
+#define STEP 4
+
+// Tree reduction of both local arrays, leaves the sums in element 0
+inline void reduceWorkGroup(__local Accumulator* dangling, __local Accumulator* residual) {
+    int lid = get_local_id(0);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int stride = get_local_size(0) / 2; stride > 0; stride >>= 1) {
+        if (lid < stride) {
+            dangling[lid] += dangling[lid + stride];
+            residual[lid] += residual[lid + stride];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
 }
 
+// The superstep kernels make a single pass over the vertices. The dangling
+// share of a step is only known after that pass, so the rank written by a
+// step is still missing it (the "base" rank); the next step adds the pending
+// share while reading the rank, and at the same time produces the residual
+// against the rank before it and the dangling mass of the completed rank.
+// The per-work-group partials of both are reduced by reduceStepKernel.
+// nextPageRanks holds the previous ranks on entry and the next base on exit.
+
+// Consumes inbox[v] (and clears it, so it can serve as the next outbox) and
+// pushes the completed rank along the out-edges
 __kernel void pageRankKernel(
-    __global const double* inbox,
-    __global const double* pageRanks,
+    __global Rank* inbox,
+    __global Rank* pageRanks,
+    __global Rank* nextPageRanks,
     __global const int* offsets,
     __global const int* edges,
-    __global double* nextPageRanks,
-    __global double* outbox,
+    __global Rank* outbox,
+    __global Accumulator* partials,
+    __global const Accumulator* stepState,
     int n,
-    double damping)
+    Accumulator damping)
 {
+    __local Accumulator localDangling[256];
+    __local Accumulator localResidual[256];
+
+    int lid = get_local_id(0);
     int v = get_global_id(0);
-    if (v >= n) return;
 
-    double sum = inbox[v];
-    nextPageRanks[v] = (1.0 - damping) / n + damping * sum;
+    if (stepState[HALTED] != 0.0) return;
 
-    int start = offsets[v];
-    int end = offsets[v + 1];
-    
-    if (start < end) {
-        double share = pageRanks[v] / (end - start);
-        for (int i = start; i < end; ++i) {
-            int u = edges[i];
-            atomic_add_double(&outbox[u], share);
+    Accumulator dangling = 0.0;
+    Accumulator residual = 0.0;
+
+    if (v < n) {
+        Accumulator rank = pageRanks[v] + stepState[PENDING_SHARE];
+        pageRanks[v] = rank;
+        residual = fabs(rank - nextPageRanks[v]);
+
+        nextPageRanks[v] = (1.0 - damping) / n + damping * inbox[v];
+        inbox[v] = 0.0;
+
+        int start = offsets[v];
+        int end = offsets[v + 1];
+
+        if (start < end) {
+            Accumulator share = rank / (end - start);
+            for (int i = start; i < end; ++i) {
+                int u = edges[i];
+                atomic_add_rank(&outbox[u], share);
+            }
+        } else {
+            dangling = rank;
         }
     }
+
+    localDangling[lid] = dangling;
+    localResidual[lid] = residual;
+    reduceWorkGroup(localDangling, localResidual);
+
+    if (lid == 0) {
+        partials[2 * get_group_id(0)] = localDangling[0];
+        partials[2 * get_group_id(0) + 1] = localResidual[0];
+    }
 }
 
-__kernel void danglingMassKernel(
-    __global const double* pageRanks,
+// Pull variant over the in-edges (CSC): no atomics. contributions holds the
+// shares sent in the previous superstep (rank / out-degree), every vertex
+// gathers them and writes its own share for the next superstep.
+// Light vertices get one work-item each...
+__kernel void pullLightKernel(
+    __global const int* vertices,
+    int count,
+    __global const int* inOffsets,
+    __global const int* inEdges,
     __global const int* offsets,
-    __global double* danglingMass,
-    int n)
+    __global const Rank* contributions,
+    __global Rank* nextContributions,
+    __global Rank* pageRanks,
+    __global Rank* nextPageRanks,
+    __global Accumulator* partials,
+    __global const Accumulator* stepState,
+    int n,
+    Accumulator damping)
 {
-    __local double localSum[256];
-    
+    __local Accumulator localDangling[256];
+    __local Accumulator localResidual[256];
+
     int lid = get_local_id(0);
-    int v = get_global_id(0);
-    
-    double sum = 0.0;
-    if (v < n && offsets[v] == offsets[v + 1]) {
-        sum = pageRanks[v];
-    }
-    
-    localSum[lid] = sum;
-    barrier(CLK_LOCAL_MEM_FENCE);
+    int k = get_global_id(0);
 
-    for (int stride = get_local_size(0) / 2; stride > 0; stride >>= 1) {
-        if (lid < stride) {
-            localSum[lid] += localSum[lid + stride];
+    if (stepState[HALTED] != 0.0) return;
+
+    Accumulator dangling = 0.0;
+    Accumulator residual = 0.0;
+
+    if (k < count) {
+        int v = vertices[k];
+        Accumulator rank = pageRanks[v] + stepState[PENDING_SHARE];
+        pageRanks[v] = rank;
+        residual = fabs(rank - nextPageRanks[v]);
+
+        Accumulator sum = 0.0;
+        for (int i = inOffsets[v]; i < inOffsets[v + 1]; ++i) {
+            sum += contributions[inEdges[i]];
+        }
+        nextPageRanks[v] = (1.0 - damping) / n + damping * sum;
+
+        int degree = offsets[v + 1] - offsets[v];
+        nextContributions[v] = degree > 0 ? rank / degree : 0.0;
+        if (degree == 0) {
+            dangling = rank;
         }
-        barrier(CLK_LOCAL_MEM_FENCE);
     }
 
+    localDangling[lid] = dangling;
+    localResidual[lid] = residual;
+    reduceWorkGroup(localDangling, localResidual);
+
     if (lid == 0) {
-        atomic_add_double(danglingMass, localSum[0]);
+        partials[2 * get_group_id(0)] = localDangling[0];
+        partials[2 * get_group_id(0) + 1] = localResidual[0];
     }
 }
 
-__kernel void addDanglingMassKernel(
-    __global double* nextPageRanks,
-    double danglingShare,
-    int n)
+// ...heavy vertices get a whole work-group that strides over their in-edges
+// and combines the partial sums in local memory. Their partials follow the
+// ones of the light work-groups.
+__kernel void pullHeavyKernel(
+    __global const int* vertices,
+    __global const int* inOffsets,
+    __global const int* inEdges,
+    __global const int* offsets,
+    __global const Rank* contributions,
+    __global Rank* nextContributions,
+    __global Rank* pageRanks,
+    __global Rank* nextPageRanks,
+    __global Accumulator* partials,
+    int partialOffset,
+    __global const Accumulator* stepState,
+    int n,
+    Accumulator damping)
 {
-    int v = get_global_id(0);
-    if (v >= n) return;
-    nextPageRanks[v] += danglingShare;
+    __local Accumulator localSum[256];
+    __local Accumulator unused[256];
+
+    int lid = get_local_id(0);
+    int v = vertices[get_group_id(0)];
+
+    if (stepState[HALTED] != 0.0) return;
+
+    Accumulator sum = 0.0;
+    for (int i = inOffsets[v] + lid; i < inOffsets[v + 1]; i += get_local_size(0)) {
+        sum += contributions[inEdges[i]];
+    }
+
+    localSum[lid] = sum;
+    unused[lid] = 0.0;
+    reduceWorkGroup(localSum, unused);
+
+    if (lid == 0) {
+        Accumulator rank = pageRanks[v] + stepState[PENDING_SHARE];
+        pageRanks[v] = rank;
+        Accumulator residual = fabs(rank - nextPageRanks[v]);
+        nextPageRanks[v] = (1.0 - damping) / n + damping * localSum[0];
+
+        int degree = offsets[v + 1] - offsets[v];
+        nextContributions[v] = degree > 0 ? rank / degree : 0.0;
+
+        int partial = partialOffset + get_group_id(0);
+        partials[2 * partial] = degree == 0 ? rank : 0.0;
+        partials[2 * partial + 1] = residual;
+    }
+}
+
+// Second reduction stage, run as a single work-group: sums the per-group
+// partials, turns the dangling mass into the share pending for the next
+// step, records the residual of the step that just completed (there is none
+// before the first one) and halts once it drops below epsilon
+__kernel void reduceStepKernel(
+    __global const Accumulator* partials,
+    int partialCount,
+    __global Accumulator* stepState,
+    Accumulator epsilon,
+    int n,
+    Accumulator damping)
+{
+    __local Accumulator localDangling[256];
+    __local Accumulator localResidual[256];
+
+    int lid = get_local_id(0);
+
+    if (stepState[HALTED] != 0.0) return;
+
+    Accumulator dangling = 0.0;
+    Accumulator residual = 0.0;
+    for (int i = lid; i < partialCount; i += get_local_size(0)) {
+        dangling += partials[2 * i];
+        residual += partials[2 * i + 1];
+    }
+
+    localDangling[lid] = dangling;
+    localResidual[lid] = residual;
+    reduceWorkGroup(localDangling, localResidual);
+
+    if (lid == 0) {
+        Accumulator step = stepState[STEP];
+        if (step >= 1.0) {
+            stepState[RESIDUAL] = localResidual[0];
+            stepState[SUPERSTEPS] = step;
+            if (localResidual[0] < epsilon) {
+                stepState[HALTED] = 1.0;
+            }
+        }
+        stepState[PENDING_SHARE] = damping * localDangling[0] / n;
+        stepState[STEP] = step + 1.0;
+    }
 }
 )";
 
@@ -105,61 +316,83 @@ void checkError(cl_int err, const char* operation) {
     }
 }
 
-void loadInput(const string& filename, unordered_map<string, int>& pageIds, vector<string>& pageNames, vector<int>& edges, vector<int>& offsets) {
-    ifstream file(filename);
-    string line, word;
-
-    auto getId = [&](const string& s) {
-        if (!pageIds.count(s)) {
-            int idx = pageIds.size();
-            pageIds[s] = idx;
-            pageNames.push_back(s);
-        }
-        return pageIds[s];
-    };
+void generateOutput(const string& filename, const vector<double>& pageRanks, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime, long long reorderTime) {
+    ofstream outFile(filename);
 
-    vector<vector<int>> tmpEdges;
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << " " << reorderTime << endl;
+    for (size_t i = 0; i < pageRanks.size(); ++i) {
+        outFile << pageNames[i] << " " << pageRanks[i] << endl;
+    }
 
-    while (getline(file, line)) {
-        stringstream ss(line);
-        ss >> word;
-        int u = getId(word);
+    outFile.close();
+}
 
-        if ((int)tmpEdges.size() <= u) {
-            tmpEdges.resize(u + 1);
-        }
+// Degree binning for the pull mode, done once at load time
+void binVerticesByInDegree(const Graph& graph, vector<int>& lightVertices, vector<int>& heavyVertices) {
+    lightVertices.clear();
+    heavyVertices.clear();
 
-        while (ss >> word) {
-            int v = getId(word);
-            tmpEdges[u].push_back(v);
+    for (int v = 0; v < graph.n; ++v) {
+        if (graph.inDegree(v) >= HEAVY_IN_DEGREE) {
+            heavyVertices.push_back(v);
+        } else {
+            lightVertices.push_back(v);
         }
     }
+}
 
-    offsets.push_back(0);
-    for (const auto& vec : tmpEdges) {
-        edges.insert(edges.end(), vec.begin(), vec.end());
-        offsets.push_back(edges.size());
-    }
+cl_mem createIntBuffer(cl_context context, const int* data, size_t count, const char* operation) {
+    cl_int err;
+    // Zero-sized buffers are invalid, keep a single element for empty arrays
+    int empty = 0;
+    cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, max<size_t>(count, 1) * sizeof(int), count > 0 ? (void*)data : &empty, &err);
+    checkError(err, operation);
+    return buffer;
+}
 
-    while ((int)offsets.size() <= (int)pageIds.size()) {
-        offsets.push_back(edges.size());
-    }
+size_t roundUp(size_t count, size_t multiple) {
+    return (count + multiple - 1) / multiple * multiple;
 }
 
-void generateOutput(const string& filename, const vector<double>& pageRanks, const vector<string>& pageNames, long long executionTime) {
-    ofstream outFile(filename);
+bool hasDoubleSupport(cl_device_id device) {
+    size_t size;
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &size);
+    string extensions(size, '\0');
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, size, &extensions[0], NULL);
+    return extensions.find("cl_khr_fp64") != string::npos;
+}
 
-    outFile << executionTime << endl;
-    for (size_t i = 0; i < pageRanks.size(); ++i) {
-        outFile << pageNames[i] << " " << pageRanks[i] << endl;
+// Scalar kernel arguments of the device Accumulator type
+void setAccumulatorArg(cl_kernel kernel, cl_uint index, double value, bool doubleAccumulator) {
+    if (doubleAccumulator) {
+        clSetKernelArg(kernel, index, sizeof(double), &value);
+    } else {
+        float singleValue = value;
+        clSetKernelArg(kernel, index, sizeof(float), &singleValue);
     }
+}
 
-    outFile.close();
+// Rank buffers to and from checkpoint vectors, blocking
+template <typename Rank>
+void readRanks(cl_command_queue queue, cl_mem buffer, int n, double* out, const char* operation) {
+    vector<Rank> values(n);
+    cl_int err = clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0, n * sizeof(Rank), values.data(), 0, NULL, NULL);
+    checkError(err, operation);
+    copyToCheckpoint(values.data(), n, out);
 }
 
-vector<double> rankPages(unordered_map<string, int>& pageIds, vector<string>& pageNames, vector<int>& edges, vector<int>& offsets, int maxSupersteps) {
-    int n = pageIds.size();
-    int m = edges.size();
+template <typename Rank>
+void writeRanks(cl_command_queue queue, cl_mem buffer, int n, const double* in, const char* operation) {
+    vector<Rank> values(n);
+    copyFromCheckpoint(in, n, values.data());
+    cl_int err = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0, n * sizeof(Rank), values.data(), 0, NULL, NULL);
+    checkError(err, operation);
+}
+
+template <typename Rank>
+vector<Rank> rankPages(const Graph& graph, bool pullMode, const vector<int>& lightVertices, const vector<int>& heavyVertices, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int checkInterval, int& supersteps, double& residual) {
+    int n = graph.n;
+    int m = graph.edgeCount();
 
     cl_int err;
     cl_platform_id platform;
@@ -186,7 +419,21 @@ vector<double> rankPages(unordered_map<string, int>& pageIds, vector<string>& pa
     program = clCreateProgramWithSource(context, 1, &kernelSource, NULL, &err);
     checkError(err, "clCreateProgramWithSource");
     
-    err = clBuildProgram(program, 1, &device, NULL, NULL, NULL);
+    // Sums stay in double where the device supports it, ranks in Rank
+    bool doubleRank = sizeof(Rank) == sizeof(double);
+    bool doubleAccumulator = hasDoubleSupport(device);
+    if (doubleRank && !doubleAccumulator) {
+        cerr << "Error: the OpenCL device has no fp64 support, use --precision float" << endl;
+        exit(1);
+    }
+    size_t accumulatorSize = doubleAccumulator ? sizeof(double) : sizeof(float);
+
+    string buildOptions = "-DRANK_DOUBLE=" + to_string(doubleRank) + " -DACCUMULATOR_DOUBLE=" + to_string(doubleAccumulator);
+    if (!doubleAccumulator) {
+        buildOptions += " -cl-single-precision-constant";
+    }
+
+    err = clBuildProgram(program, 1, &device, buildOptions.c_str(), NULL, NULL);
     if (err != CL_SUCCESS) {
         size_t log_size;
         clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
@@ -196,103 +443,233 @@ vector<double> rankPages(unordered_map<string, int>& pageIds, vector<string>& pa
         delete[] log;
         exit(1);
     }
-    
-    cl_kernel pageRankKernel = clCreateKernel(program, "pageRankKernel", &err);
-    checkError(err, "clCreateKernel pageRankKernel");
-    
-    cl_kernel danglingMassKernel = clCreateKernel(program, "danglingMassKernel", &err);
-    checkError(err, "clCreateKernel danglingMassKernel");
-    
-    cl_kernel addDanglingMassKernel = clCreateKernel(program, "addDanglingMassKernel", &err);
-    checkError(err, "clCreateKernel addDanglingMassKernel");
 
-    vector<double> h_pageRanks(n, 1.0 / n);
-    vector<double> h_inbox(n, 0.0);
+    vector<Rank> h_pageRanks(n, 1.0 / n);
+    vector<double> h_stepState(STEP_STATE_SIZE, 0.0);
+
+    // Rank and message buffers come in pairs that swap roles every superstep:
+    // inbox/outbox for push, previous/next contributions for pull
+    cl_mem d_pageRanks[2], d_boxes[2];
 
-    cl_mem d_pageRanks = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, n * sizeof(double), h_pageRanks.data(), &err);
+    d_pageRanks[0] = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, n * sizeof(Rank), h_pageRanks.data(), &err);
     checkError(err, "clCreateBuffer pageRanks");
     
-    cl_mem d_nextPageRanks = clCreateBuffer(context, CL_MEM_READ_WRITE, n * sizeof(double), NULL, &err);
+    d_pageRanks[1] = clCreateBuffer(context, CL_MEM_READ_WRITE, n * sizeof(Rank), NULL, &err);
     checkError(err, "clCreateBuffer nextPageRanks");
     
-    cl_mem d_inbox = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, n * sizeof(double), h_inbox.data(), &err);
+    d_boxes[0] = clCreateBuffer(context, CL_MEM_READ_WRITE, n * sizeof(Rank), NULL, &err);
     checkError(err, "clCreateBuffer inbox");
     
-    cl_mem d_outbox = clCreateBuffer(context, CL_MEM_READ_WRITE, n * sizeof(double), NULL, &err);
+    d_boxes[1] = clCreateBuffer(context, CL_MEM_READ_WRITE, n * sizeof(Rank), NULL, &err);
     checkError(err, "clCreateBuffer outbox");
     
-    cl_mem d_edges = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m * sizeof(int), edges.data(), &err);
-    checkError(err, "clCreateBuffer edges");
-    
-    cl_mem d_offsets = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, (n + 1) * sizeof(int), offsets.data(), &err);
-    checkError(err, "clCreateBuffer offsets");
+    cl_mem d_offsets = createIntBuffer(context, graph.offsets, n + 1, "clCreateBuffer offsets");
+    cl_mem d_edges = createIntBuffer(context, graph.edges, pullMode ? 0 : m, "clCreateBuffer edges");
+    cl_mem d_inOffsets = createIntBuffer(context, graph.inOffsets.data(), pullMode ? n + 1 : 0, "clCreateBuffer inOffsets");
+    cl_mem d_inEdges = createIntBuffer(context, graph.inEdges.data(), pullMode ? m : 0, "clCreateBuffer inEdges");
+    cl_mem d_lightVertices = createIntBuffer(context, lightVertices.data(), lightVertices.size(), "clCreateBuffer lightVertices");
+    cl_mem d_heavyVertices = createIntBuffer(context, heavyVertices.data(), heavyVertices.size(), "clCreateBuffer heavyVertices");
     
-    cl_mem d_danglingMass = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(double), NULL, &err);
-    checkError(err, "clCreateBuffer danglingMass");
-
-    size_t globalWorkSize = ((n + 255) / 256) * 256;
-    size_t localWorkSize = 256;
-
-    for (int step = 0; step < maxSupersteps; ++step) {
-        double zero = 0.0;
-        err = clEnqueueFillBuffer(queue, d_outbox, &zero, sizeof(double), 0, n * sizeof(double), 0, NULL, NULL);
-        checkError(err, "clEnqueueFillBuffer outbox");
-        
-        err = clEnqueueFillBuffer(queue, d_danglingMass, &zero, sizeof(double), 0, sizeof(double), 0, NULL, NULL);
-        checkError(err, "clEnqueueFillBuffer danglingMass");
-
-        clSetKernelArg(pageRankKernel, 0, sizeof(cl_mem), &d_inbox);
-        clSetKernelArg(pageRankKernel, 1, sizeof(cl_mem), &d_pageRanks);
-        clSetKernelArg(pageRankKernel, 2, sizeof(cl_mem), &d_offsets);
-        clSetKernelArg(pageRankKernel, 3, sizeof(cl_mem), &d_edges);
-        clSetKernelArg(pageRankKernel, 4, sizeof(cl_mem), &d_nextPageRanks);
-        clSetKernelArg(pageRankKernel, 5, sizeof(cl_mem), &d_outbox);
-        clSetKernelArg(pageRankKernel, 6, sizeof(int), &n);
-        clSetKernelArg(pageRankKernel, 7, sizeof(double), &DAMPING);
-
-        err = clEnqueueNDRangeKernel(queue, pageRankKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
-        checkError(err, "clEnqueueNDRangeKernel pageRankKernel");
-
-        clSetKernelArg(danglingMassKernel, 0, sizeof(cl_mem), &d_pageRanks);
-        clSetKernelArg(danglingMassKernel, 1, sizeof(cl_mem), &d_offsets);
-        clSetKernelArg(danglingMassKernel, 2, sizeof(cl_mem), &d_danglingMass);
-        clSetKernelArg(danglingMassKernel, 3, sizeof(int), &n);
-
-        err = clEnqueueNDRangeKernel(queue, danglingMassKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
-        checkError(err, "clEnqueueNDRangeKernel danglingMassKernel");
-
-        double danglingMass;
-        err = clEnqueueReadBuffer(queue, d_danglingMass, CL_TRUE, 0, sizeof(double), &danglingMass, 0, NULL, NULL);
-        checkError(err, "clEnqueueReadBuffer danglingMass");
-
-        double danglingShare = DAMPING * danglingMass / n;
-
-        clSetKernelArg(addDanglingMassKernel, 0, sizeof(cl_mem), &d_nextPageRanks);
-        clSetKernelArg(addDanglingMassKernel, 1, sizeof(double), &danglingShare);
-        clSetKernelArg(addDanglingMassKernel, 2, sizeof(int), &n);
-
-        err = clEnqueueNDRangeKernel(queue, addDanglingMassKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
-        checkError(err, "clEnqueueNDRangeKernel addDanglingMassKernel");
-
-        err = clEnqueueCopyBuffer(queue, d_outbox, d_inbox, 0, 0, n * sizeof(double), 0, NULL, NULL);
-        checkError(err, "clEnqueueCopyBuffer");
-        
-        swap(d_pageRanks, d_nextPageRanks);
+    cl_mem d_stepState = clCreateBuffer(context, CL_MEM_READ_WRITE, STEP_STATE_SIZE * accumulatorSize, NULL, &err);
+    checkError(err, "clCreateBuffer stepState");
+
+    // All-zero bytes are 0.0 in both float and double
+    double zero = 0.0;
+    for (cl_mem buffer : {d_boxes[0], d_boxes[1], d_pageRanks[1]}) {
+        err = clEnqueueFillBuffer(queue, buffer, &zero, sizeof(Rank), 0, n * sizeof(Rank), 0, NULL, NULL);
+        checkError(err, "clEnqueueFillBuffer");
+    }
+    err = clEnqueueFillBuffer(queue, d_stepState, &zero, accumulatorSize, 0, STEP_STATE_SIZE * accumulatorSize, 0, NULL, NULL);
+    checkError(err, "clEnqueueFillBuffer stepState");
+
+    size_t globalWorkSize = roundUp(n, WORK_GROUP_SIZE);
+    int lightCount = lightVertices.size();
+    int lightGroups = roundUp(lightCount, WORK_GROUP_SIZE) / WORK_GROUP_SIZE;
+    int partialCount = pullMode ? lightGroups + heavyVertices.size() : globalWorkSize / WORK_GROUP_SIZE;
+
+    // Dangling mass and residual of every work-group, [2 * group] and [2 * group + 1]
+    cl_mem d_partials = clCreateBuffer(context, CL_MEM_READ_WRITE, 2 * max(partialCount, 1) * accumulatorSize, NULL, &err);
+    checkError(err, "clCreateBuffer partials");
+
+    // The kernels of one superstep, with one instance per buffer parity so
+    // all arguments are set once here and the loop only enqueues
+    vector<KernelLaunch> stepLaunches[2];
+    for (int parity = 0; parity < 2; ++parity) {
+        cl_mem& current = d_pageRanks[parity];
+        cl_mem& next = d_pageRanks[1 - parity];
+        cl_mem& inbox = d_boxes[parity];
+        cl_mem& outbox = d_boxes[1 - parity];
+
+        if (pullMode) {
+            cl_kernel pullLightKernel = clCreateKernel(program, "pullLightKernel", &err);
+            checkError(err, "clCreateKernel pullLightKernel");
+            clSetKernelArg(pullLightKernel, 0, sizeof(cl_mem), &d_lightVertices);
+            clSetKernelArg(pullLightKernel, 1, sizeof(int), &lightCount);
+            clSetKernelArg(pullLightKernel, 2, sizeof(cl_mem), &d_inOffsets);
+            clSetKernelArg(pullLightKernel, 3, sizeof(cl_mem), &d_inEdges);
+            clSetKernelArg(pullLightKernel, 4, sizeof(cl_mem), &d_offsets);
+            clSetKernelArg(pullLightKernel, 5, sizeof(cl_mem), &inbox);
+            clSetKernelArg(pullLightKernel, 6, sizeof(cl_mem), &outbox);
+            clSetKernelArg(pullLightKernel, 7, sizeof(cl_mem), &current);
+            clSetKernelArg(pullLightKernel, 8, sizeof(cl_mem), &next);
+            clSetKernelArg(pullLightKernel, 9, sizeof(cl_mem), &d_partials);
+            clSetKernelArg(pullLightKernel, 10, sizeof(cl_mem), &d_stepState);
+            clSetKernelArg(pullLightKernel, 11, sizeof(int), &n);
+            setAccumulatorArg(pullLightKernel, 12, DAMPING, doubleAccumulator);
+            if (lightCount > 0) {
+                stepLaunches[parity].push_back({pullLightKernel, roundUp(lightCount, WORK_GROUP_SIZE), WORK_GROUP_SIZE});
+            } else {
+                clReleaseKernel(pullLightKernel);
+            }
+
+            cl_kernel pullHeavyKernel = clCreateKernel(program, "pullHeavyKernel", &err);
+            checkError(err, "clCreateKernel pullHeavyKernel");
+            clSetKernelArg(pullHeavyKernel, 0, sizeof(cl_mem), &d_heavyVertices);
+            clSetKernelArg(pullHeavyKernel, 1, sizeof(cl_mem), &d_inOffsets);
+            clSetKernelArg(pullHeavyKernel, 2, sizeof(cl_mem), &d_inEdges);
+            clSetKernelArg(pullHeavyKernel, 3, sizeof(cl_mem), &d_offsets);
+            clSetKernelArg(pullHeavyKernel, 4, sizeof(cl_mem), &inbox);
+            clSetKernelArg(pullHeavyKernel, 5, sizeof(cl_mem), &outbox);
+            clSetKernelArg(pullHeavyKernel, 6, sizeof(cl_mem), &current);
+            clSetKernelArg(pullHeavyKernel, 7, sizeof(cl_mem), &next);
+            clSetKernelArg(pullHeavyKernel, 8, sizeof(cl_mem), &d_partials);
+            clSetKernelArg(pullHeavyKernel, 9, sizeof(int), &lightGroups);
+            clSetKernelArg(pullHeavyKernel, 10, sizeof(cl_mem), &d_stepState);
+            clSetKernelArg(pullHeavyKernel, 11, sizeof(int), &n);
+            setAccumulatorArg(pullHeavyKernel, 12, DAMPING, doubleAccumulator);
+            if (!heavyVertices.empty()) {
+                stepLaunches[parity].push_back({pullHeavyKernel, heavyVertices.size() * WORK_GROUP_SIZE, WORK_GROUP_SIZE});
+            } else {
+                clReleaseKernel(pullHeavyKernel);
+            }
+        } else {
+            cl_kernel pageRankKernel = clCreateKernel(program, "pageRankKernel", &err);
+            checkError(err, "clCreateKernel pageRankKernel");
+            clSetKernelArg(pageRankKernel, 0, sizeof(cl_mem), &inbox);
+            clSetKernelArg(pageRankKernel, 1, sizeof(cl_mem), &current);
+            clSetKernelArg(pageRankKernel, 2, sizeof(cl_mem), &next);
+            clSetKernelArg(pageRankKernel, 3, sizeof(cl_mem), &d_offsets);
+            clSetKernelArg(pageRankKernel, 4, sizeof(cl_mem), &d_edges);
+            clSetKernelArg(pageRankKernel, 5, sizeof(cl_mem), &outbox);
+            clSetKernelArg(pageRankKernel, 6, sizeof(cl_mem), &d_partials);
+            clSetKernelArg(pageRankKernel, 7, sizeof(cl_mem), &d_stepState);
+            clSetKernelArg(pageRankKernel, 8, sizeof(int), &n);
+            setAccumulatorArg(pageRankKernel, 9, DAMPING, doubleAccumulator);
+            stepLaunches[parity].push_back({pageRankKernel, globalWorkSize, WORK_GROUP_SIZE});
+        }
+
+        cl_kernel reduceStepKernel = clCreateKernel(program, "reduceStepKernel", &err);
+        checkError(err, "clCreateKernel reduceStepKernel");
+        clSetKernelArg(reduceStepKernel, 0, sizeof(cl_mem), &d_partials);
+        clSetKernelArg(reduceStepKernel, 1, sizeof(int), &partialCount);
+        clSetKernelArg(reduceStepKernel, 2, sizeof(cl_mem), &d_stepState);
+        setAccumulatorArg(reduceStepKernel, 3, epsilon, doubleAccumulator);
+        clSetKernelArg(reduceStepKernel, 4, sizeof(int), &n);
+        setAccumulatorArg(reduceStepKernel, 5, DAMPING, doubleAccumulator);
+        stepLaunches[parity].push_back({reduceStepKernel, WORK_GROUP_SIZE, WORK_GROUP_SIZE});
+    }
+
+    supersteps = 0;
+    residual = 0.0;
+
+    // After launch k - 1 the device holds the completed ranks of superstep
+    // k - 1, the base ranks of superstep k, the inbox of launch k and the
+    // pending share; a checkpoint keeps those three vectors in that order
+    int firstLaunch = 0;
+    if (checkpoints.resume) {
+        Checkpoint checkpoint;
+        readCheckpoint(checkpoints.path, n, 3, checkpoint);
+        firstLaunch = checkpoint.header.superstep + 1;
+        int parity = firstLaunch % 2;
+        writeRanks<Rank>(queue, d_pageRanks[1 - parity], n, checkpoint.vector(0), "clEnqueueWriteBuffer pageRanks");
+        writeRanks<Rank>(queue, d_pageRanks[parity], n, checkpoint.vector(1), "clEnqueueWriteBuffer nextPageRanks");
+        writeRanks<Rank>(queue, d_boxes[parity], n, checkpoint.vector(2), "clEnqueueWriteBuffer inbox");
+
+        h_stepState[PENDING_SHARE] = checkpoint.header.scalars[1];
+        h_stepState[RESIDUAL] = checkpoint.header.scalars[0];
+        h_stepState[SUPERSTEPS] = checkpoint.header.superstep;
+        h_stepState[HALTED] = checkpoint.header.superstep > 0 && checkpoint.header.scalars[0] < epsilon ? 1.0 : 0.0;
+        h_stepState[STEP] = firstLaunch;
+
+        vector<char> stepStateBytes(STEP_STATE_SIZE * accumulatorSize);
+        for (int i = 0; i < STEP_STATE_SIZE; ++i) {
+            if (doubleAccumulator) {
+                reinterpret_cast<double*>(stepStateBytes.data())[i] = h_stepState[i];
+            } else {
+                reinterpret_cast<float*>(stepStateBytes.data())[i] = h_stepState[i];
+            }
+        }
+        err = clEnqueueWriteBuffer(queue, d_stepState, CL_TRUE, 0, stepStateBytes.size(), stepStateBytes.data(), 0, NULL, NULL);
+        checkError(err, "clEnqueueWriteBuffer stepState");
     }
+    CheckpointWriter checkpointWriter(checkpoints, n, 3);
+
+    // Supersteps are enqueued in batches; the step state is read back (and the
+    // queue synchronized) only once per batch. Once halted on the device the
+    // remaining steps of a batch are no-ops. Step maxSupersteps only completes
+    // the last rank and its residual. Batches also end at every checkpoint.
+    bool halted = h_stepState[HALTED] != 0.0;
+    for (int batchStart = firstLaunch; batchStart <= maxSupersteps && !halted; ) {
+        int batchEnd = min(batchStart + checkInterval, maxSupersteps + 1);
+        if (checkpoints.interval > 0) {
+            batchEnd = min(batchEnd, (batchStart / checkpoints.interval + 1) * checkpoints.interval + 1);
+        }
+
+        for (int step = batchStart; step < batchEnd; ++step) {
+            for (const KernelLaunch& launch : stepLaunches[step % 2]) {
+                err = clEnqueueNDRangeKernel(queue, launch.kernel, 1, NULL, &launch.globalSize, &launch.localSize, 0, NULL, NULL);
+                checkError(err, "clEnqueueNDRangeKernel");
+            }
+        }
+
+        vector<char> stepStateBytes(STEP_STATE_SIZE * accumulatorSize);
+        err = clEnqueueReadBuffer(queue, d_stepState, CL_TRUE, 0, stepStateBytes.size(), stepStateBytes.data(), 0, NULL, NULL);
+        checkError(err, "clEnqueueReadBuffer stepState");
+        for (int i = 0; i < STEP_STATE_SIZE; ++i) {
+            if (doubleAccumulator) {
+                h_stepState[i] = reinterpret_cast<const double*>(stepStateBytes.data())[i];
+            } else {
+                h_stepState[i] = reinterpret_cast<const float*>(stepStateBytes.data())[i];
+            }
+        }
+        halted = h_stepState[HALTED] != 0.0;
+
+        if (!halted && checkpoints.due(batchEnd - 1)) {
+            int parity = batchEnd % 2;
+            Checkpoint& checkpoint = checkpointWriter.beginSnapshot(batchEnd - 1);
+            readRanks<Rank>(queue, d_pageRanks[1 - parity], n, checkpoint.vector(0), "clEnqueueReadBuffer pageRanks");
+            readRanks<Rank>(queue, d_pageRanks[parity], n, checkpoint.vector(1), "clEnqueueReadBuffer nextPageRanks");
+            readRanks<Rank>(queue, d_boxes[parity], n, checkpoint.vector(2), "clEnqueueReadBuffer inbox");
+            checkpoint.header.scalars[0] = h_stepState[RESIDUAL];
+            checkpoint.header.scalars[1] = h_stepState[PENDING_SHARE];
+            checkpointWriter.commitSnapshot();
+        }
+        batchStart = batchEnd;
+    }
+    checkpointWriter.finish();
+
+    supersteps = h_stepState[SUPERSTEPS];
+    residual = h_stepState[RESIDUAL];
 
-    err = clEnqueueReadBuffer(queue, d_pageRanks, CL_TRUE, 0, n * sizeof(double), h_pageRanks.data(), 0, NULL, NULL);
+    // Every superstep swapped the roles of the rank buffers
+    err = clEnqueueReadBuffer(queue, d_pageRanks[supersteps % 2], CL_TRUE, 0, n * sizeof(Rank), h_pageRanks.data(), 0, NULL, NULL);
     checkError(err, "clEnqueueReadBuffer pageRanks");
 
-    clReleaseMemObject(d_pageRanks);
-    clReleaseMemObject(d_nextPageRanks);
-    clReleaseMemObject(d_inbox);
-    clReleaseMemObject(d_outbox);
-    clReleaseMemObject(d_edges);
+    for (int parity = 0; parity < 2; ++parity) {
+        clReleaseMemObject(d_pageRanks[parity]);
+        clReleaseMemObject(d_boxes[parity]);
+        for (const KernelLaunch& launch : stepLaunches[parity]) {
+            clReleaseKernel(launch.kernel);
+        }
+    }
     clReleaseMemObject(d_offsets);
-    clReleaseMemObject(d_danglingMass);
-    clReleaseKernel(pageRankKernel);
-    clReleaseKernel(danglingMassKernel);
-    clReleaseKernel(addDanglingMassKernel);
+    clReleaseMemObject(d_edges);
+    clReleaseMemObject(d_inOffsets);
+    clReleaseMemObject(d_inEdges);
+    clReleaseMemObject(d_lightVertices);
+    clReleaseMemObject(d_heavyVertices);
+    clReleaseMemObject(d_partials);
+    clReleaseMemObject(d_stepState);
     clReleaseProgram(program);
     clReleaseCommandQueue(queue);
     clReleaseContext(context);
@@ -302,26 +679,87 @@ vector<double> rankPages(unordered_map<string, int>& pageIds, vector<string>& pa
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS>" << endl;
+        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--epsilon <EPSILON>] [--input <GRAPH_FILE>] [--check-interval <SUPERSTEPS>] [--mode push|pull] [--precision double|float] [--reorder degree|rcm|gorder] [--checkpoint <SUPERSTEPS>] [--checkpoint-file <PATH>] [--resume]" << endl;
         return 1;
     }
     int maxSupersteps = atoi(argv[1]);
 
-    unordered_map<string, int> pageIds;
-    vector<string> pageNames;
-    vector<int> edges;
-    vector<int> offsets;
-
     string inputFile = "/app/input/graph.txt";
-    loadInput(inputFile, pageIds, pageNames, edges, offsets);
+    double epsilon = 0.0;
+    int checkInterval = 64;
+    CheckpointOptions checkpoints;
+    checkpoints.path = "/app/output/accelerated.checkpoint";
+    bool pullMode = false;
+    bool singlePrecision = false;
+    VertexOrder vertexOrder = ORIGINAL_ORDER;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--check-interval" && i + 1 < argc) {
+            checkInterval = max(1, atoi(argv[++i]));
+        } else if (arg == "--mode" && i + 1 < argc) {
+            pullMode = string(argv[++i]) == "pull";
+        } else if (arg == "--precision" && i + 1 < argc) {
+            singlePrecision = string(argv[++i]) == "float";
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertexOrder = parseVertexOrder(argv[++i]);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoints.interval = max(0, atoi(argv[++i]));
+        } else if (arg == "--checkpoint-file" && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (arg == "--resume") {
+            checkpoints.resume = true;
+        }
+    }
+
+    PageNames pageNames;
+    Graph graph;
+
+    auto loadStart = high_resolution_clock::now();
+    loadGraph(inputFile, pageNames, graph);
+
+    // Relabel for locality, ranks are mapped back to the original ids below
+    auto reorderStart = high_resolution_clock::now();
+    vector<int> newIds;
+    if (vertexOrder != ORIGINAL_ORDER) {
+        newIds = reorderGraph(graph, vertexOrder);
+    }
+    long long reorderTime = duration_cast<milliseconds>(high_resolution_clock::now() - reorderStart).count();
+
+    vector<int> lightVertices, heavyVertices;
+    if (pullMode) {
+        buildInEdges(graph);
+        binVerticesByInDegree(graph, lightVertices, heavyVertices);
+    }
+    auto loadEnd = high_resolution_clock::now();
+    long long loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count() - reorderTime;
+
+    int supersteps;
+    double residual;
 
     auto start = high_resolution_clock::now();
-    vector<double> pageRanks = rankPages(pageIds, pageNames, edges, offsets, maxSupersteps);
+    vector<double> pageRanks;
+    if (singlePrecision) {
+        vector<float> singlePageRanks = rankPages<float>(graph, pullMode, lightVertices, heavyVertices, checkpoints, maxSupersteps, epsilon, checkInterval, supersteps, residual);
+        pageRanks.assign(singlePageRanks.begin(), singlePageRanks.end());
+    } else {
+        pageRanks = rankPages<double>(graph, pullMode, lightVertices, heavyVertices, checkpoints, maxSupersteps, epsilon, checkInterval, supersteps, residual);
+    }
     auto end = high_resolution_clock::now();
     long long executionTime = duration_cast<milliseconds>(end - start).count();
 
-    string outputFile = "/app/output/accelerated_" + to_string(maxSupersteps) + ".txt";
-    generateOutput(outputFile, pageRanks, pageNames, executionTime);
+    if (vertexOrder != ORIGINAL_ORDER) {
+        auto restoreStart = high_resolution_clock::now();
+        pageRanks = restoreOrder(pageRanks, newIds);
+        reorderTime += duration_cast<milliseconds>(high_resolution_clock::now() - restoreStart).count();
+        cout << "Reordered vertices (" << vertexOrderName(vertexOrder) << ") in " << reorderTime << " ms" << endl;
+    }
+
+    string outputFile = "/app/output/accelerated_" + string(pullMode ? "pull_" : "") + string(singlePrecision ? "float_" : "") + (vertexOrder != ORIGINAL_ORDER ? string(vertexOrderName(vertexOrder)) + "_" : string()) + to_string(maxSupersteps) + ".txt";
+    generateOutput(outputFile, pageRanks, pageNames, executionTime, supersteps, residual, loadTime, reorderTime);
 
     return 0;
 }
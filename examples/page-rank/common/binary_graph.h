@@ -0,0 +1,249 @@
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "mapped_file.h"
+
+// Preprocessed CSR graph file, written by the graph converter and mapped
+// directly by the engines. All sections are in native byte order and start
+// on 8-byte boundaries:
+//   header | offsets (n + 1 int32) | edges (m int32) | name offsets (n + 1 uint64) | name bytes
+const char BINARY_GRAPH_MAGIC[8] = {'P', 'R', 'G', 'R', 'A', 'P', 'H', '\0'};
+const uint32_t BINARY_GRAPH_VERSION = 1;
+
+struct BinaryGraphHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t vertexCount;
+    uint64_t edgeCount;
+    uint64_t nameBytes;
+    uint64_t offsetsPosition;
+    uint64_t edgesPosition;
+    uint64_t nameOffsetsPosition;
+    uint64_t namesPosition;
+    uint64_t fileSize;
+};
+
+inline uint64_t alignPosition(uint64_t position) {
+    return (position + 7) & ~uint64_t(7);
+}
+
+inline bool isBinaryGraph(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(BINARY_GRAPH_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && memcmp(magic, BINARY_GRAPH_MAGIC, sizeof(magic)) == 0;
+}
+
+inline void checkBinaryGraphSection(uint64_t position, uint64_t bytes, uint64_t fileSize, const char* section, const std::string& filename) {
+    if (position % 8 != 0 || position < sizeof(BinaryGraphHeader) || position > fileSize || bytes > fileSize - position) {
+        std::cerr << "Error: '" << filename << "' has its " << section << " outside the file" << std::endl;
+        exit(1);
+    }
+}
+
+inline void checkBinaryGraphHeader(const BinaryGraphHeader& header, uint64_t fileSize, const std::string& filename) {
+    if (memcmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(BINARY_GRAPH_MAGIC)) != 0) {
+        std::cerr << "Error: '" << filename << "' is not a binary graph file" << std::endl;
+        exit(1);
+    }
+    if (header.version != BINARY_GRAPH_VERSION || header.headerSize != sizeof(BinaryGraphHeader)) {
+        std::cerr << "Error: '" << filename << "' has binary graph version " << header.version << ", expected " << BINARY_GRAPH_VERSION << std::endl;
+        exit(1);
+    }
+    if (header.fileSize != fileSize) {
+        std::cerr << "Error: '" << filename << "' is truncated" << std::endl;
+        exit(1);
+    }
+    // Vertex and edge ids are int, which also keeps the section sizes below
+    // from overflowing
+    if (header.vertexCount >= uint64_t(INT_MAX) || header.edgeCount > uint64_t(INT_MAX)) {
+        std::cerr << "Error: '" << filename << "' holds " << header.vertexCount << " vertices and " << header.edgeCount
+                  << " edges, at most " << INT_MAX << " of each are supported" << std::endl;
+        exit(1);
+    }
+    checkBinaryGraphSection(header.offsetsPosition, (header.vertexCount + 1) * sizeof(int), fileSize, "offsets", filename);
+    checkBinaryGraphSection(header.edgesPosition, header.edgeCount * sizeof(int), fileSize, "edges", filename);
+    checkBinaryGraphSection(header.nameOffsetsPosition, (header.vertexCount + 1) * sizeof(uint64_t), fileSize, "name offsets", filename);
+    checkBinaryGraphSection(header.namesPosition, header.nameBytes, fileSize, "names", filename);
+}
+
+// Whether values[0] .. values[count] never decrease
+template <typename T>
+inline bool isNonDecreasing(const T* values, int64_t count) {
+    int64_t drops = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(+:drops)
+#endif
+    for (int64_t i = 0; i < count; ++i) {
+        drops += values[i + 1] < values[i];
+    }
+    return drops == 0;
+}
+
+// The offsets of rows rows must never decrease and span edges of the file
+inline void checkBinaryGraphOffsets(const int* offsets, int rows, uint64_t edgeCount, const std::string& filename) {
+    if (offsets[0] < 0 || uint64_t(offsets[rows]) > edgeCount || !isNonDecreasing(offsets, rows)) {
+        std::cerr << "Error: '" << filename << "' has corrupt offsets" << std::endl;
+        exit(1);
+    }
+}
+
+// Every edge target must be a vertex of the file
+inline void checkBinaryGraphEdges(const int* edges, int64_t count, uint64_t vertexCount, const std::string& filename) {
+    int64_t outside = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(+:outside)
+#endif
+    for (int64_t i = 0; i < count; ++i) {
+        outside += edges[i] < 0 || uint64_t(edges[i]) >= vertexCount;
+    }
+    if (outside > 0) {
+        std::cerr << "Error: '" << filename << "' has " << outside << " edges to vertices outside the graph" << std::endl;
+        exit(1);
+    }
+}
+
+inline BinaryGraphHeader readBinaryGraphHeader(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    uint64_t fileSize = file.tellg();
+    file.seekg(0);
+
+    BinaryGraphHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (file.gcount() != sizeof(header)) {
+        std::cerr << "Error: '" << filename << "' is truncated" << std::endl;
+        exit(1);
+    }
+    checkBinaryGraphHeader(header, fileSize, filename);
+    return header;
+}
+
+inline void writeBinaryGraph(const std::string& filename, const Graph& graph, const PageNames& pageNames) {
+    uint64_t n = graph.n;
+    uint64_t m = graph.m;
+
+    std::vector<uint64_t> nameOffsets(n + 1, 0);
+    for (uint64_t v = 0; v < n; ++v) {
+        nameOffsets[v + 1] = nameOffsets[v] + pageNames[v].size();
+    }
+
+    BinaryGraphHeader header = {};
+    memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(BINARY_GRAPH_MAGIC));
+    header.version = BINARY_GRAPH_VERSION;
+    header.headerSize = sizeof(BinaryGraphHeader);
+    header.vertexCount = n;
+    header.edgeCount = m;
+    header.nameBytes = nameOffsets[n];
+    header.offsetsPosition = alignPosition(sizeof(BinaryGraphHeader));
+    header.edgesPosition = alignPosition(header.offsetsPosition + (n + 1) * sizeof(int));
+    header.nameOffsetsPosition = alignPosition(header.edgesPosition + m * sizeof(int));
+    header.namesPosition = alignPosition(header.nameOffsetsPosition + (n + 1) * sizeof(uint64_t));
+    header.fileSize = header.namesPosition + header.nameBytes;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error opening output file '" << filename << "'" << std::endl;
+        exit(1);
+    }
+
+    auto writeAt = [&](uint64_t position, const void* data, uint64_t bytes) {
+        static const char padding[8] = {};
+        file.write(padding, position - file.tellp());
+        file.write(static_cast<const char*>(data), bytes);
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeAt(header.offsetsPosition, graph.offsets, (n + 1) * sizeof(int));
+    writeAt(header.edgesPosition, graph.edges, m * sizeof(int));
+    writeAt(header.nameOffsetsPosition, nameOffsets.data(), (n + 1) * sizeof(uint64_t));
+    writeAt(header.namesPosition, "", 0);
+    for (uint64_t v = 0; v < n; ++v) {
+        file.write(pageNames[v].data(), pageNames[v].size());
+    }
+
+    if (!file) {
+        std::cerr << "Error writing output file '" << filename << "'" << std::endl;
+        exit(1);
+    }
+}
+
+// Maps the whole file. Its content is validated in one pass before any
+// engine indexes with it, so every page is read in once at load time.
+inline void mapBinaryGraph(const std::string& filename, Graph& graph, PageNames& pageNames) {
+    auto file = std::make_shared<MappedFile>(filename);
+    if (file->size < sizeof(BinaryGraphHeader)) {
+        std::cerr << "Error: '" << filename << "' is truncated" << std::endl;
+        exit(1);
+    }
+
+    BinaryGraphHeader header;
+    memcpy(&header, file->data, sizeof(header));
+    checkBinaryGraphHeader(header, file->fileSize, filename);
+
+    graph = Graph();
+    graph.n = header.vertexCount;
+    graph.m = header.edgeCount;
+    graph.offsets = reinterpret_cast<const int*>(file->data + header.offsetsPosition);
+    graph.edges = reinterpret_cast<const int*>(file->data + header.edgesPosition);
+    graph.mappings.push_back(file);
+    checkBinaryGraphOffsets(graph.offsets, graph.n, header.edgeCount, filename);
+    if (graph.offsets[0] != 0 || graph.offsets[graph.n] != graph.m) {
+        std::cerr << "Error: '" << filename << "' has corrupt offsets" << std::endl;
+        exit(1);
+    }
+    checkBinaryGraphEdges(graph.edges, graph.m, header.vertexCount, filename);
+
+    pageNames = PageNames();
+    pageNames.offsets = reinterpret_cast<const uint64_t*>(file->data + header.nameOffsetsPosition);
+    if (pageNames.offsets[0] != 0 || pageNames.offsets[header.vertexCount] != header.nameBytes || !isNonDecreasing(pageNames.offsets, header.vertexCount)) {
+        std::cerr << "Error: '" << filename << "' has corrupt name offsets" << std::endl;
+        exit(1);
+    }
+    pageNames.chars = file->data + header.namesPosition;
+    pageNames.count = header.vertexCount;
+    pageNames.mapping = file;
+}
+
+// Maps only the rows [start, end) and the edges they own. The offsets are
+// copied and rebased to 0, the edges (global target ids) stay in the mapping;
+// both are validated as in mapBinaryGraph.
+inline void mapBinaryGraphSlice(const std::string& filename, int start, int end, Graph& localGraph) {
+    BinaryGraphHeader header = readBinaryGraphHeader(filename);
+    if (start < 0 || uint64_t(end) > header.vertexCount) {
+        std::cerr << "Error: rows " << start << " to " << end << " are outside the " << header.vertexCount << " vertices of '" << filename << "'" << std::endl;
+        exit(1);
+    }
+    int localN = end > start ? end - start : 0;
+
+    localGraph = Graph();
+    localGraph.offsetStorage.assign(localN + 1, 0);
+
+    if (localN > 0) {
+        MappedFile offsetSlice(filename, header.offsetsPosition + uint64_t(start) * sizeof(int), uint64_t(localN + 1) * sizeof(int));
+        const int* offsets = reinterpret_cast<const int*>(offsetSlice.data);
+        checkBinaryGraphOffsets(offsets, localN, header.edgeCount, filename);
+        for (int i = 0; i <= localN; ++i) {
+            localGraph.offsetStorage[i] = offsets[i] - offsets[0];
+        }
+
+        auto edgeSlice = std::make_shared<MappedFile>(filename, header.edgesPosition + uint64_t(offsets[0]) * sizeof(int), uint64_t(localGraph.offsetStorage[localN]) * sizeof(int));
+        localGraph.mappings.push_back(edgeSlice);
+        localGraph.edges = reinterpret_cast<const int*>(edgeSlice->data);
+        checkBinaryGraphEdges(localGraph.edges, localGraph.offsetStorage[localN], header.vertexCount, filename);
+    }
+
+    localGraph.n = localN;
+    localGraph.m = localGraph.offsetStorage[localN];
+    localGraph.offsets = localGraph.offsetStorage.data();
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Superstep state a run can be resumed from, in native byte order:
+//   header | vector 0 (n double) | vector 1 (n double) | ...
+// Which vectors and scalars are stored is up to the engine, scalar 0 is
+// always the residual of the last superstep. Vertices are in the order the
+// engine runs them, so a run is resumed with the same input and --reorder.
+const char CHECKPOINT_MAGIC[8] = {'P', 'R', 'C', 'H', 'E', 'C', 'K', '\0'};
+const uint32_t CHECKPOINT_VERSION = 1;
+const int CHECKPOINT_SCALARS = 8;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t vertexCount;
+    uint64_t vectorCount;
+    uint64_t superstep;
+    double scalars[CHECKPOINT_SCALARS];
+};
+
+inline CheckpointHeader makeCheckpointHeader(int n, int vectors) {
+    CheckpointHeader header = {};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.vertexCount = n;
+    header.vectorCount = vectors;
+    return header;
+}
+
+struct Checkpoint {
+    CheckpointHeader header = {};
+    std::vector<double> data;
+
+    void allocate(int n, int vectors) {
+        header = makeCheckpointHeader(n, vectors);
+        data.resize((size_t)n * vectors);
+    }
+
+    double* vector(int k) {
+        return data.data() + (size_t)k * header.vertexCount;
+    }
+
+    const double* vector(int k) const {
+        return data.data() + (size_t)k * header.vertexCount;
+    }
+};
+
+// --checkpoint <SUPERSTEPS>, --checkpoint-file <PATH> and --resume
+struct CheckpointOptions {
+    int interval = 0;
+    std::string path;
+    bool resume = false;
+
+    bool due(int superstep) const {
+        return interval > 0 && superstep > 0 && superstep % interval == 0;
+    }
+};
+
+// Why header cannot be resumed by a run of n vertices and vectors vectors,
+// empty if it can
+inline std::string checkpointHeaderError(const CheckpointHeader& header, int n, int vectors, const std::string& path) {
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        return "'" + path + "' is not a checkpoint file";
+    }
+    if (header.version != CHECKPOINT_VERSION || header.headerSize != sizeof(CheckpointHeader)) {
+        return "'" + path + "' has checkpoint version " + std::to_string(header.version) + ", expected " + std::to_string(CHECKPOINT_VERSION);
+    }
+    if (header.vertexCount != (uint64_t)n || header.vectorCount != (uint64_t)vectors) {
+        return "'" + path + "' holds " + std::to_string(header.vectorCount) + " vectors of " + std::to_string(header.vertexCount)
+               + " vertices, this run needs " + std::to_string(vectors) + " of " + std::to_string(n);
+    }
+    return "";
+}
+
+inline void checkCheckpointHeader(const CheckpointHeader& header, int n, int vectors, const std::string& path) {
+    std::string error = checkpointHeaderError(header, n, vectors, path);
+    if (!error.empty()) {
+        std::cerr << "Error: " << error << std::endl;
+        exit(1);
+    }
+}
+
+inline void readCheckpoint(const std::string& path, int n, int vectors, Checkpoint& checkpoint) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error opening checkpoint file '" << path << "'" << std::endl;
+        exit(1);
+    }
+
+    file.read(reinterpret_cast<char*>(&checkpoint.header), sizeof(CheckpointHeader));
+    if (file.gcount() != sizeof(CheckpointHeader)) {
+        std::cerr << "Error: '" << path << "' is not a checkpoint file" << std::endl;
+        exit(1);
+    }
+    checkCheckpointHeader(checkpoint.header, n, vectors, path);
+
+    checkpoint.data.resize((size_t)n * vectors);
+    file.read(reinterpret_cast<char*>(checkpoint.data.data()), checkpoint.data.size() * sizeof(double));
+    if ((size_t)file.gcount() != checkpoint.data.size() * sizeof(double)) {
+        std::cerr << "Error: '" << path << "' is truncated" << std::endl;
+        exit(1);
+    }
+}
+
+template <typename T>
+inline void copyToCheckpoint(const T* values, int n, double* out) {
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int v = 0; v < n; ++v) {
+        out[v] = values[v];
+    }
+}
+
+template <typename T>
+inline void copyFromCheckpoint(const double* in, int n, T* values) {
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int v = 0; v < n; ++v) {
+        values[v] = in[v];
+    }
+}
+
+// Writes checkpoints from a background thread. The engine fills one of two
+// snapshot buffers between beginSnapshot and commitSnapshot; the thread
+// writes it to path.tmp, syncs it and renames it over path, so path always
+// holds a complete checkpoint. beginSnapshot only waits if the buffer's
+// previous write is still running: the copy and that wait are all the
+// superstep loop pays.
+struct CheckpointWriter {
+    std::string path;
+    int interval = 0;
+    Checkpoint buffers[2];
+    bool busy[2] = {false, false};
+    int current = 0;
+    std::deque<int> queue;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+
+    int written = 0;
+    std::chrono::steady_clock::time_point snapshotStart;
+    double snapshotSeconds = 0.0;
+    double waitSeconds = 0.0;
+    double writeSeconds = 0.0;
+
+    CheckpointWriter(const CheckpointOptions& options, int n, int vectors) : path(options.path), interval(options.interval) {
+        if (interval > 0) {
+            buffers[0].allocate(n, vectors);
+            buffers[1].allocate(n, vectors);
+            thread = std::thread([this] { writeLoop(); });
+        }
+    }
+
+    ~CheckpointWriter() {
+        finish();
+    }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    Checkpoint& beginSnapshot(int superstep) {
+        snapshotStart = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return !busy[current]; });
+        }
+        waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshotStart).count();
+
+        Checkpoint& checkpoint = buffers[current];
+        checkpoint.header.superstep = superstep;
+        std::fill(checkpoint.header.scalars, checkpoint.header.scalars + CHECKPOINT_SCALARS, 0.0);
+        return checkpoint;
+    }
+
+    void commitSnapshot() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy[current] = true;
+            queue.push_back(current);
+        }
+        changed.notify_all();
+        current = 1 - current;
+        snapshotSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshotStart).count();
+    }
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            int buffer = queue.front();
+            queue.pop_front();
+
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            writeCheckpointFile(buffers[buffer]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+
+            writeSeconds += seconds;
+            ++written;
+            busy[buffer] = false;
+            changed.notify_all();
+        }
+    }
+
+    void writeCheckpointFile(const Checkpoint& checkpoint) {
+        std::string tmpPath = path + ".tmp";
+        FILE* file = fopen(tmpPath.c_str(), "wb");
+        if (file == nullptr) {
+            std::cerr << "Error opening checkpoint file '" << tmpPath << "'" << std::endl;
+            return;
+        }
+        bool ok = fwrite(&checkpoint.header, sizeof(CheckpointHeader), 1, file) == 1;
+        ok = ok && fwrite(checkpoint.data.data(), sizeof(double), checkpoint.data.size(), file) == checkpoint.data.size();
+        ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Error writing checkpoint file '" << path << "'" << std::endl;
+        }
+    }
+
+    // Waits for the queued writes and reports what the checkpoints cost
+    void finish() {
+        if (!thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+
+        std::cout << "Checkpoints: " << written << " every " << interval << " supersteps to " << path << ", "
+                  << snapshotSeconds * 1000.0 << " ms on the critical path (" << waitSeconds * 1000.0 << " ms waiting), "
+                  << writeSeconds * 1000.0 << " ms writing in the background" << std::endl;
+    }
+};
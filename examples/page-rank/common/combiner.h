@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+// Pregel combiners: messages to the same vertex are folded into one at the
+// sender, before they are stored or exchanged. A combiner is any type with
+//   static T identity();
+//   static T combine(T a, T b);
+// where combine is associative and commutative and identity is its neutral
+// element, so the folded value does not depend (up to rounding) on the order
+// messages arrive in.
+template <typename T>
+struct SumCombiner {
+    static T identity() {
+        return T(0);
+    }
+
+    static T combine(T a, T b) {
+        return a + b;
+    }
+};
+
+template <typename T>
+struct MinCombiner {
+    static T identity() {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    static T combine(T a, T b) {
+        return std::min(a, b);
+    }
+};
+
+template <typename T>
+struct MaxCombiner {
+    static T identity() {
+        return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+
+    static T combine(T a, T b) {
+        return std::max(a, b);
+    }
+};
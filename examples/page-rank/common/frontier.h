@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Representation switch of direction-optimizing BFS: a sparse frontier turns
+// dense once its out-edges exceed m / FRONTIER_ALPHA, a dense one turns
+// sparse again below n / FRONTIER_BETA vertices
+const int FRONTIER_ALPHA = 14;
+const int FRONTIER_BETA = 24;
+
+// Active vertices of a superstep, either as a sparse queue of ids or as a
+// dense bitmap. The bitmap is all zero while the frontier is sparse, so a
+// sparse superstep costs only as much as its queue.
+struct Frontier {
+    int n = 0;
+    bool dense = false;
+    std::vector<int> vertices;
+    std::vector<uint64_t> bits;
+    long long count = 0;
+    long long edges = 0;
+
+    void allocate(int vertexCount) {
+        n = vertexCount;
+        dense = false;
+        vertices.clear();
+        bits.assign((n + 63) / 64, 0);
+        count = 0;
+        edges = 0;
+    }
+
+    bool contains(int v) const {
+        return (bits[v >> 6] >> (v & 63)) & 1;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        if (dense) {
+            std::fill(bits.begin(), bits.end(), 0);
+        }
+        dense = false;
+        vertices.clear();
+        count = 0;
+        edges = 0;
+    }
+
+    // Sparse build: the queue holds the active vertices
+    void assignQueue(const int* offsets) {
+        dense = false;
+        count = vertices.size();
+        edges = 0;
+        for (int v : vertices) {
+            edges += offsets[v + 1] - offsets[v];
+        }
+    }
+
+    // Dense build: scans every vertex, each thread filling whole words
+    template <typename Active>
+    void assignBitmap(const int* offsets, Active active) {
+        dense = true;
+        vertices.clear();
+        long long activeCount = 0, activeEdges = 0;
+        int words = bits.size();
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) reduction(+:activeCount, activeEdges)
+#endif
+        for (int word = 0; word < words; ++word) {
+            uint64_t wordBits = 0;
+            int last = std::min(n, (word + 1) * 64);
+            for (int v = word * 64; v < last; ++v) {
+                if (active(v)) {
+                    wordBits |= uint64_t(1) << (v & 63);
+                    ++activeCount;
+                    activeEdges += offsets[v + 1] - offsets[v];
+                }
+            }
+            bits[word] = wordBits;
+        }
+        count = activeCount;
+        edges = activeEdges;
+    }
+
+    // Switches to the representation the next superstep should use
+    void adapt(long long m) {
+        bool wantDense = dense ? count >= n / FRONTIER_BETA : edges > m / FRONTIER_ALPHA;
+        if (wantDense && !dense) {
+            for (int v : vertices) {
+                bits[v >> 6] |= uint64_t(1) << (v & 63);
+            }
+            vertices.clear();
+            dense = true;
+        } else if (!wantDense && dense) {
+            vertices.clear();
+            for (size_t word = 0; word < bits.size(); ++word) {
+                for (uint64_t wordBits = bits[word]; wordBits != 0; wordBits &= wordBits - 1) {
+                    vertices.push_back(word * 64 + __builtin_ctzll(wordBits));
+                }
+                bits[word] = 0;
+            }
+            dense = false;
+        }
+    }
+
+    void swap(Frontier& other) {
+        std::swap(n, other.n);
+        std::swap(dense, other.dense);
+        vertices.swap(other.vertices);
+        bits.swap(other.bits);
+        std::swap(count, other.count);
+        std::swap(edges, other.edges);
+    }
+};
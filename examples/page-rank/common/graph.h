@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Compressed sparse row (CSR) adjacency shared by all PageRank engines.
+// Out-edges of vertex v are edges[offsets[v]] .. edges[offsets[v + 1] - 1].
+// offsets/edges point either at the owned storage vectors or into a mapped
+// binary graph file. The transposed (CSC) in-edge arrays are only filled by
+// buildInEdges.
+struct Graph {
+    int n = 0;
+    int m = 0;
+    const int* offsets = nullptr;
+    const int* edges = nullptr;
+    std::vector<int> inOffsets;
+    std::vector<int> inEdges;
+
+    std::vector<int> offsetStorage;
+    std::vector<int> edgeStorage;
+    std::vector<std::shared_ptr<MappedFile>> mappings;
+
+    Graph() = default;
+    Graph(Graph&&) = default;
+    Graph& operator=(Graph&&) = default;
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
+
+    int edgeCount() const {
+        return m;
+    }
+
+    int outDegree(int v) const {
+        return offsets[v + 1] - offsets[v];
+    }
+
+    int inDegree(int v) const {
+        return inOffsets[v + 1] - inOffsets[v];
+    }
+
+    bool hasInEdges() const {
+        return !inOffsets.empty();
+    }
+
+    // Points offsets/edges at offsetStorage/edgeStorage
+    void useStorage() {
+        n = offsetStorage.empty() ? 0 : offsetStorage.size() - 1;
+        m = edgeStorage.size();
+        offsets = offsetStorage.data();
+        edges = edgeStorage.data();
+    }
+};
+
+// Vertex names in id order, owned when parsed from text and viewed in place
+// when mapped from a binary graph
+struct PageNames {
+    std::vector<std::string> owned;
+    const uint64_t* offsets = nullptr;
+    const char* chars = nullptr;
+    size_t count = 0;
+    std::shared_ptr<MappedFile> mapping;
+
+    size_t size() const {
+        return offsets != nullptr ? count : owned.size();
+    }
+
+    std::string_view operator[](size_t v) const {
+        if (offsets != nullptr) {
+            return std::string_view(chars + offsets[v], offsets[v + 1] - offsets[v]);
+        }
+        return owned[v];
+    }
+};
+
+// Builds the CSR from an edge list with a counting sort, so the out-edges of
+// every vertex keep the order in which they appear in the input
+inline void buildGraph(int n, const std::vector<int>& sources, const std::vector<int>& targets, Graph& graph) {
+    graph.offsetStorage.assign(n + 1, 0);
+    graph.edgeStorage.resize(sources.size());
+    graph.inOffsets.clear();
+    graph.inEdges.clear();
+    graph.mappings.clear();
+
+    for (int u : sources) {
+        graph.offsetStorage[u + 1]++;
+    }
+
+    for (int v = 0; v < n; ++v) {
+        graph.offsetStorage[v + 1] += graph.offsetStorage[v];
+    }
+
+    std::vector<int> position(graph.offsetStorage.begin(), graph.offsetStorage.end() - 1);
+    for (size_t i = 0; i < sources.size(); ++i) {
+        graph.edgeStorage[position[sources[i]]++] = targets[i];
+    }
+
+    graph.useStorage();
+}
+
+inline void buildInEdges(Graph& graph) {
+    int n = graph.n;
+
+    graph.inOffsets.assign(n + 1, 0);
+    graph.inEdges.resize(graph.m);
+
+    for (int i = 0; i < graph.m; ++i) {
+        graph.inOffsets[graph.edges[i] + 1]++;
+    }
+
+    for (int v = 0; v < n; ++v) {
+        graph.inOffsets[v + 1] += graph.inOffsets[v];
+    }
+
+    std::vector<int> position(graph.inOffsets.begin(), graph.inOffsets.end() - 1);
+    for (int v = 0; v < n; ++v) {
+        for (int i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+            graph.inEdges[position[graph.edges[i]]++] = v;
+        }
+    }
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "binary_graph.h"
+#include "graph.h"
+#include "mapped_file.h"
+
+// Open-addressing (linear probing) table from a token key to a vertex id.
+// Keys are raw values on the numeric path and name hashes otherwise.
+struct IdTable {
+    std::vector<uint64_t> keys;
+    std::vector<int> ids;
+    int bits = 0;
+    size_t count = 0;
+
+    IdTable() {
+        resize(16);
+    }
+
+    size_t home(uint64_t key) const {
+        return (key * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+    }
+
+    // Returns the slot holding an entry for key accepted by same, or the
+    // empty slot where such an entry belongs
+    template <typename Same>
+    size_t find(uint64_t key, Same same) const {
+        size_t mask = ids.size() - 1;
+        size_t slot = home(key);
+        while (ids[slot] != -1 && !(keys[slot] == key && same(ids[slot]))) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void insert(size_t slot, uint64_t key, int id) {
+        keys[slot] = key;
+        ids[slot] = id;
+        if (++count * 2 > ids.size()) {
+            resize(bits + 1);
+        }
+    }
+
+    void resize(int newBits) {
+        std::vector<uint64_t> oldKeys;
+        std::vector<int> oldIds;
+        oldKeys.swap(keys);
+        oldIds.swap(ids);
+
+        bits = newBits;
+        keys.assign(size_t(1) << bits, 0);
+        ids.assign(size_t(1) << bits, -1);
+
+        size_t mask = ids.size() - 1;
+        for (size_t i = 0; i < oldIds.size(); ++i) {
+            if (oldIds[i] != -1) {
+                size_t slot = home(oldKeys[i]);
+                while (ids[slot] != -1) {
+                    slot = (slot + 1) & mask;
+                }
+                keys[slot] = oldKeys[i];
+                ids[slot] = oldIds[i];
+            }
+        }
+    }
+};
+
+// Tokens of one line-aligned slice of the input
+struct InputChunk {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<size_t> tokenStarts;
+    std::vector<uint64_t> keys;
+    std::vector<int> ids;
+    size_t lineCount = 0;
+    bool numeric = true;
+};
+
+const size_t LINE_START = size_t(1) << 63;
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isDelimiter(char c) {
+    return isBlank(c) || c == '\n';
+}
+
+// Splits the chunk into tokens, recording for each one its start offset (with
+// LINE_START set on the source token of a line) and its key. A token is
+// numeric when it is a canonical decimal below 2^31, so that its value can
+// stand in for the name.
+inline void scanChunk(const char* text, InputChunk& chunk) {
+    size_t pos = chunk.begin;
+    bool lineStart = true;
+
+    while (pos < chunk.end) {
+        char c = text[pos];
+        if (c == '\n') {
+            lineStart = true;
+            ++pos;
+            continue;
+        }
+        if (isBlank(c)) {
+            ++pos;
+            continue;
+        }
+
+        size_t start = pos;
+        uint64_t hash = 14695981039346656037ull;
+        uint64_t value = 0;
+        bool numeric = true;
+
+        while (pos < chunk.end && !isDelimiter(text[pos])) {
+            unsigned char byte = text[pos];
+            hash = (hash ^ byte) * 1099511628211ull;
+            if (numeric && byte >= '0' && byte <= '9' && value < (1ull << 31)) {
+                value = value * 10 + (byte - '0');
+            } else {
+                numeric = false;
+            }
+            ++pos;
+        }
+
+        size_t length = pos - start;
+        if (value >= (1ull << 31) || (length > 1 && text[start] == '0')) {
+            numeric = false;
+        }
+
+        chunk.numeric = chunk.numeric && numeric;
+        chunk.tokenStarts.push_back(lineStart ? (start | LINE_START) : start);
+        chunk.keys.push_back(numeric ? value : hash);
+        if (lineStart) {
+            chunk.lineCount++;
+        }
+        lineStart = false;
+    }
+}
+
+// Assigns vertex ids in first-seen order. Numeric inputs key the table by
+// value (or index a dense array when the values are compact), names are
+// keyed by hash and confirmed against the stored name.
+inline void internTokens(const char* text, size_t textSize, std::vector<InputChunk>& chunks, bool numeric, std::vector<std::string>& pageNames) {
+    size_t tokenCount = 0;
+    uint64_t maxValue = 0;
+    for (const InputChunk& chunk : chunks) {
+        tokenCount += chunk.keys.size();
+        if (numeric && !chunk.keys.empty()) {
+            maxValue = std::max(maxValue, *std::max_element(chunk.keys.begin(), chunk.keys.end()));
+        }
+    }
+
+    auto tokenLength = [&](size_t start) {
+        size_t end = start;
+        while (end < textSize && !isDelimiter(text[end])) {
+            ++end;
+        }
+        return end - start;
+    };
+
+    if (numeric && maxValue < 4 * tokenCount + 1024) {
+        std::vector<int> idOfValue(maxValue + 1, -1);
+        for (InputChunk& chunk : chunks) {
+            chunk.ids.resize(chunk.keys.size());
+            for (size_t t = 0; t < chunk.keys.size(); ++t) {
+                int& id = idOfValue[chunk.keys[t]];
+                if (id == -1) {
+                    id = pageNames.size();
+                    pageNames.push_back(std::to_string(chunk.keys[t]));
+                }
+                chunk.ids[t] = id;
+            }
+        }
+        return;
+    }
+
+    IdTable table;
+    for (InputChunk& chunk : chunks) {
+        chunk.ids.resize(chunk.keys.size());
+        for (size_t t = 0; t < chunk.keys.size(); ++t) {
+            size_t start = chunk.tokenStarts[t] & ~LINE_START;
+            const char* token = text + start;
+
+            size_t slot = table.find(chunk.keys[t], [&](int id) {
+                if (numeric) {
+                    return true;
+                }
+                const std::string& name = pageNames[id];
+                size_t end = start + name.size();
+                return end <= textSize && memcmp(token, name.data(), name.size()) == 0 && (end == textSize || isDelimiter(text[end]));
+            });
+
+            if (table.ids[slot] == -1) {
+                int id = pageNames.size();
+                pageNames.emplace_back(token, tokenLength(start));
+                table.insert(slot, chunk.keys[t], id);
+                chunk.ids[t] = id;
+            } else {
+                chunk.ids[t] = table.ids[slot];
+            }
+        }
+    }
+}
+
+// Loads "<source> <target> <target> ..." adjacency lines into a CSR graph.
+// The file is memory mapped and split into line-aligned chunks that are
+// tokenized in parallel; ids are then interned serially in file order, so
+// pageNames[v] is the name of vertex v in order of first appearance.
+inline void parseTextGraph(const std::string& filename, PageNames& pageNames, Graph& graph) {
+    MappedFile file(filename);
+    const char* text = file.data;
+
+    int chunkCount = 1;
+#ifdef _OPENMP
+    chunkCount = omp_get_max_threads();
+#endif
+
+    std::vector<InputChunk> chunks(chunkCount);
+    for (int c = 0; c < chunkCount; ++c) {
+        size_t begin = file.size * c / chunkCount;
+        if (begin > 0) {
+            while (begin < file.size && text[begin - 1] != '\n') {
+                ++begin;
+            }
+        }
+        chunks[c].begin = begin;
+    }
+    for (int c = 0; c < chunkCount; ++c) {
+        chunks[c].end = c + 1 < chunkCount ? chunks[c + 1].begin : file.size;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1)
+#endif
+    for (int c = 0; c < chunkCount; ++c) {
+        scanChunk(text, chunks[c]);
+    }
+
+    bool numeric = true;
+    for (const InputChunk& chunk : chunks) {
+        numeric = numeric && chunk.numeric;
+    }
+
+    pageNames = PageNames();
+    internTokens(text, file.size, chunks, numeric, pageNames.owned);
+
+    std::vector<size_t> edgeOffsets(chunkCount + 1, 0);
+    for (int c = 0; c < chunkCount; ++c) {
+        edgeOffsets[c + 1] = edgeOffsets[c] + chunks[c].ids.size() - chunks[c].lineCount;
+    }
+
+    std::vector<int> sources(edgeOffsets[chunkCount]);
+    std::vector<int> targets(edgeOffsets[chunkCount]);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1)
+#endif
+    for (int c = 0; c < chunkCount; ++c) {
+        const InputChunk& chunk = chunks[c];
+        size_t position = edgeOffsets[c];
+        int source = -1;
+
+        for (size_t t = 0; t < chunk.ids.size(); ++t) {
+            if (chunk.tokenStarts[t] & LINE_START) {
+                source = chunk.ids[t];
+            } else {
+                sources[position] = source;
+                targets[position] = chunk.ids[t];
+                ++position;
+            }
+        }
+    }
+
+    buildGraph(pageNames.size(), sources, targets, graph);
+}
+
+// Maps binary graphs written by the graph converter, parses anything else as text
+inline void loadGraph(const std::string& filename, PageNames& pageNames, Graph& graph) {
+    if (isBinaryGraph(filename)) {
+        mapBinaryGraph(filename, graph, pageNames);
+    } else {
+        parseTextGraph(filename, pageNames, graph);
+    }
+}
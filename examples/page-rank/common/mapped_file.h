@@ -0,0 +1,67 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Read-only memory mapping of a file, or of the byte range [offset, offset + length)
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t fileSize = 0;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    explicit MappedFile(const std::string& filename, size_t offset = 0, size_t length = SIZE_MAX) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error opening input file '" << filename << "'" << std::endl;
+            exit(1);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            std::cerr << "Error reading size of input file '" << filename << "'" << std::endl;
+            exit(1);
+        }
+        fileSize = info.st_size;
+
+        if (offset > fileSize) {
+            offset = fileSize;
+        }
+        size = length < fileSize - offset ? length : fileSize - offset;
+
+        if (size > 0) {
+            // mmap offsets must be page aligned
+            size_t pageSize = sysconf(_SC_PAGESIZE);
+            size_t alignedOffset = offset - offset % pageSize;
+            mappingSize = size + (offset - alignedOffset);
+
+            mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, alignedOffset);
+            if (mapping == MAP_FAILED) {
+                std::cerr << "Error mapping input file '" << filename << "'" << std::endl;
+                exit(1);
+            }
+            madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping) + (offset - alignedOffset);
+        }
+
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (mapping != nullptr) {
+            munmap(mapping, mappingSize);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
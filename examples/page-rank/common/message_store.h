@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "combiner.h"
+#include "graph.h"
+
+// Per-vertex message lists of a Pregel superstep in a single arena. Vertex v
+// owns the slots offsets[v] .. offsets[v + 1] - 1, one per in-edge, in the
+// order of the transposed (CSC) graph; ends[v] is where the next message to v
+// goes. Slots are sized once from the in-degrees, so sending along out-edges
+// never allocates and the messages of a vertex are read back contiguously.
+template <typename T>
+struct MessageStore {
+    std::vector<int> offsets;
+    std::vector<int> ends;
+    std::vector<T> slots;
+
+    // One slot per in-edge of every vertex
+    void allocate(const Graph& graph) {
+        int n = graph.n;
+        offsets.assign(n + 1, 0);
+        if (graph.hasInEdges()) {
+            std::copy(graph.inOffsets.begin(), graph.inOffsets.end(), offsets.begin());
+        } else {
+            for (int i = 0; i < graph.m; ++i) {
+                offsets[graph.edges[i] + 1]++;
+            }
+            for (int v = 0; v < n; ++v) {
+                offsets[v + 1] += offsets[v];
+            }
+        }
+        ends.assign(offsets.begin(), offsets.end() - 1);
+        slots.resize(graph.m);
+    }
+
+    // Drops all messages, keeping the arena
+    void clear() {
+        std::copy(offsets.begin(), offsets.end() - 1, ends.begin());
+    }
+
+    // A vertex receives at most one message per in-edge
+    void send(int target, T message) {
+        slots[ends[target]++] = message;
+    }
+
+    const T* begin(int v) const {
+        return slots.data() + offsets[v];
+    }
+
+    const T* end(int v) const {
+        return slots.data() + ends[v];
+    }
+
+    void swap(MessageStore& other) {
+        offsets.swap(other.offsets);
+        ends.swap(other.ends);
+        slots.swap(other.slots);
+    }
+};
+
+// Message store that folds the messages to a vertex with Combiner as they are
+// sent, keeping one value per vertex instead of one slot per in-edge. A
+// vertex reads back its combined message, or nothing if none was sent.
+template <typename T, typename Combiner>
+struct CombinedMessageStore {
+    std::vector<T> values;
+    std::vector<char> received;
+
+    void allocate(const Graph& graph) {
+        values.assign(graph.n, Combiner::identity());
+        received.assign(graph.n, 0);
+    }
+
+    void clear() {
+        std::fill(values.begin(), values.end(), Combiner::identity());
+        std::fill(received.begin(), received.end(), 0);
+    }
+
+    void send(int target, T message) {
+        values[target] = Combiner::combine(values[target], message);
+        received[target] = 1;
+    }
+
+    const T* begin(int v) const {
+        return values.data() + v;
+    }
+
+    const T* end(int v) const {
+        return values.data() + v + received[v];
+    }
+
+    void swap(CombinedMessageStore& other) {
+        values.swap(other.values);
+        received.swap(other.received);
+    }
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+// Relabelings applied after load so that vertices accessed together get
+// nearby ids. Engines run in the new order and map the ranks back by id.
+enum VertexOrder {
+    ORIGINAL_ORDER,
+    DEGREE_ORDER,
+    RCM_ORDER,
+    GORDER
+};
+
+// Vertices that were placed within the last GORDER_WINDOW positions count
+// towards a candidate's locality score
+const int GORDER_WINDOW = 5;
+
+inline VertexOrder parseVertexOrder(const std::string& name) {
+    if (name == "degree") {
+        return DEGREE_ORDER;
+    } else if (name == "rcm") {
+        return RCM_ORDER;
+    } else if (name == "gorder") {
+        return GORDER;
+    }
+    return ORIGINAL_ORDER;
+}
+
+inline const char* vertexOrderName(VertexOrder order) {
+    switch (order) {
+        case DEGREE_ORDER: return "degree";
+        case RCM_ORDER: return "rcm";
+        case GORDER: return "gorder";
+        default: return "original";
+    }
+}
+
+inline std::vector<int> countInDegrees(const Graph& graph) {
+    std::vector<int> inDegrees(graph.n, 0);
+    for (int i = 0; i < graph.m; ++i) {
+        inDegrees[graph.edges[i]]++;
+    }
+    return inDegrees;
+}
+
+// Old ids sorted by in-degree, highest first, so the most written and read
+// vertices share cache lines. Ties keep their original order.
+inline std::vector<int> degreeOrder(const Graph& graph) {
+    std::vector<int> inDegrees = countInDegrees(graph);
+    std::vector<int> order(graph.n);
+    for (int v = 0; v < graph.n; ++v) {
+        order[v] = v;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return inDegrees[a] > inDegrees[b];
+    });
+    return order;
+}
+
+// Out- and in-neighbours of every vertex as one CSR, the undirected view
+// used by RCM and Gorder
+inline void buildUndirectedAdjacency(const Graph& graph, std::vector<int>& offsets, std::vector<int>& neighbours) {
+    int n = graph.n;
+    offsets.assign(n + 1, 0);
+    for (int v = 0; v < n; ++v) {
+        offsets[v + 1] += graph.outDegree(v);
+        for (int i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+            offsets[graph.edges[i] + 1]++;
+        }
+    }
+    for (int v = 0; v < n; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    neighbours.resize(offsets[n]);
+    std::vector<int> position(offsets.begin(), offsets.end() - 1);
+    for (int v = 0; v < n; ++v) {
+        for (int i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+            int u = graph.edges[i];
+            neighbours[position[v]++] = u;
+            neighbours[position[u]++] = v;
+        }
+    }
+}
+
+// Reverse Cuthill-McKee on the undirected graph: breadth-first from a
+// minimum degree vertex of every component, visiting neighbours by
+// increasing degree, then reversed
+inline std::vector<int> rcmOrder(const Graph& graph) {
+    int n = graph.n;
+    std::vector<int> offsets, neighbours;
+    buildUndirectedAdjacency(graph, offsets, neighbours);
+
+    auto degree = [&](int v) {
+        return offsets[v + 1] - offsets[v];
+    };
+
+    std::vector<int> starts(n);
+    for (int v = 0; v < n; ++v) {
+        starts[v] = v;
+    }
+    std::stable_sort(starts.begin(), starts.end(), [&](int a, int b) {
+        return degree(a) < degree(b);
+    });
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<int> level;
+
+    for (int start : starts) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        order.push_back(start);
+
+        for (size_t head = order.size() - 1; head < order.size(); ++head) {
+            int v = order[head];
+            level.clear();
+            for (int i = offsets[v]; i < offsets[v + 1]; ++i) {
+                int u = neighbours[i];
+                if (!visited[u]) {
+                    visited[u] = true;
+                    level.push_back(u);
+                }
+            }
+            std::stable_sort(level.begin(), level.end(), [&](int a, int b) {
+                return degree(a) < degree(b);
+            });
+            order.insert(order.end(), level.begin(), level.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Greedy Gorder: the next vertex is the one sharing the most neighbours and
+// common in-neighbours (siblings) with the last GORDER_WINDOW placed
+// vertices. Scores live in a lazy max-heap; an entry is current only while
+// its score matches. In-neighbours above sqrt(n) out-degree are skipped when
+// counting siblings, and when no candidate scores the next unplaced vertex
+// by in-degree is taken.
+inline std::vector<int> gorderOrder(const Graph& graph) {
+    int n = graph.n;
+    std::vector<int> offsets, neighbours;
+    buildUndirectedAdjacency(graph, offsets, neighbours);
+
+    Graph transposed;
+    transposed.n = n;
+    transposed.m = graph.m;
+    transposed.offsets = graph.offsets;
+    transposed.edges = graph.edges;
+    buildInEdges(transposed);
+
+    int hubDegree = std::max(1, int(std::sqrt(double(n))));
+    std::vector<int> byDegree = degreeOrder(graph);
+    size_t nextByDegree = 0;
+
+    std::vector<int> scores(n, 0);
+    std::vector<bool> placed(n, false);
+    std::priority_queue<std::pair<int, int>> candidates;
+
+    auto adjust = [&](int v, int delta) {
+        auto bump = [&](int u) {
+            if (!placed[u]) {
+                scores[u] += delta;
+                if (scores[u] > 0) {
+                    candidates.push({scores[u], u});
+                }
+            }
+        };
+        for (int i = offsets[v]; i < offsets[v + 1]; ++i) {
+            bump(neighbours[i]);
+        }
+        for (int i = transposed.inOffsets[v]; i < transposed.inOffsets[v + 1]; ++i) {
+            int w = transposed.inEdges[i];
+            if (graph.outDegree(w) <= hubDegree) {
+                for (int j = graph.offsets[w]; j < graph.offsets[w + 1]; ++j) {
+                    bump(graph.edges[j]);
+                }
+            }
+        }
+    };
+
+    std::vector<int> order;
+    order.reserve(n);
+    while ((int)order.size() < n) {
+        int next = -1;
+        while (!candidates.empty()) {
+            std::pair<int, int> top = candidates.top();
+            candidates.pop();
+            if (!placed[top.second] && scores[top.second] == top.first) {
+                next = top.second;
+                break;
+            }
+        }
+        if (next < 0) {
+            while (placed[byDegree[nextByDegree]]) {
+                ++nextByDegree;
+            }
+            next = byDegree[nextByDegree];
+        }
+
+        placed[next] = true;
+        order.push_back(next);
+        adjust(next, 1);
+        if ((int)order.size() > GORDER_WINDOW) {
+            adjust(order[order.size() - 1 - GORDER_WINDOW], -1);
+        }
+    }
+    return order;
+}
+
+// Relabels graph in place by the given order and returns newIds, where
+// newIds[v] is the id old vertex v now has. Out-edges keep their order;
+// in-edges, if present, are rebuilt.
+inline std::vector<int> reorderGraph(Graph& graph, VertexOrder vertexOrder) {
+    int n = graph.n;
+    std::vector<int> order;
+    if (vertexOrder == DEGREE_ORDER) {
+        order = degreeOrder(graph);
+    } else if (vertexOrder == RCM_ORDER) {
+        order = rcmOrder(graph);
+    } else if (vertexOrder == GORDER) {
+        order = gorderOrder(graph);
+    } else {
+        order.resize(n);
+        for (int v = 0; v < n; ++v) {
+            order[v] = v;
+        }
+    }
+
+    std::vector<int> newIds(n);
+    for (int i = 0; i < n; ++i) {
+        newIds[order[i]] = i;
+    }
+
+    std::vector<int> offsets(n + 1, 0);
+    std::vector<int> edges;
+    edges.reserve(graph.m);
+    for (int i = 0; i < n; ++i) {
+        int v = order[i];
+        for (int j = graph.offsets[v]; j < graph.offsets[v + 1]; ++j) {
+            edges.push_back(newIds[graph.edges[j]]);
+        }
+        offsets[i + 1] = edges.size();
+    }
+
+    bool hadInEdges = graph.hasInEdges();
+    graph.offsetStorage.swap(offsets);
+    graph.edgeStorage.swap(edges);
+    graph.mappings.clear();
+    graph.inOffsets.clear();
+    graph.inEdges.clear();
+    graph.useStorage();
+    if (hadInEdges) {
+        buildInEdges(graph);
+    }
+    return newIds;
+}
+
+// Brings values computed in the reordered graph back to original ids
+template <typename T>
+std::vector<T> restoreOrder(const std::vector<T>& values, const std::vector<int>& newIds) {
+    std::vector<T> restored(newIds.size());
+    for (size_t v = 0; v < newIds.size(); ++v) {
+        restored[v] = values[newIds[v]];
+    }
+    return restored;
+}
@@ -0,0 +1,32 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "../common/binary_graph.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+
+using namespace std;
+using namespace std::chrono;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cout << "Input or output file is missing..." << endl << "Usage: " << argv[0] << " <TEXT_GRAPH_FILE> <BINARY_GRAPH_FILE>" << endl;
+        return 1;
+    }
+    string inputFile = argv[1];
+    string outputFile = argv[2];
+
+    PageNames pageNames;
+    Graph graph;
+
+    auto start = high_resolution_clock::now();
+    parseTextGraph(inputFile, pageNames, graph);
+    writeBinaryGraph(outputFile, graph, pageNames);
+    auto end = high_resolution_clock::now();
+    long long conversionTime = duration_cast<milliseconds>(end - start).count();
+
+    cout << "Converted " << graph.n << " vertices and " << graph.m << " edges to " << outputFile << " in " << conversionTime << " ms" << endl;
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/checkpoint.h"
+
+// Checkpoints of a run split over ranks, in the layout of checkpoint.h with a
+// single vector indexed by global vertex id, so a run can resume on another
+// number of processes or partition. Every rank writes the values of its own
+// vertices through an indexed file view with nonblocking collective MPI-IO,
+// rank 0 also the header. The supersteps go on while a write is in flight
+// from one of two snapshot buffers; it is completed at the next checkpoint
+// or in finish, when the ranks close path.tmp and rank 0 renames it over
+// path.
+struct MpiCheckpointWriter {
+    std::string path;
+    int interval = 0;
+    int rank = 0;
+    int localN = 0;
+    MPI_Datatype fileType = MPI_DATATYPE_NULL;
+
+    std::vector<double> buffers[2];
+    CheckpointHeader headers[2];
+    int current = 0;
+    bool writing = false;
+    MPI_File file = MPI_FILE_NULL;
+    MPI_Request request = MPI_REQUEST_NULL;
+
+    int written = 0;
+    double snapshotStart = 0.0;
+    double snapshotSeconds = 0.0;
+    double waitSeconds = 0.0;
+
+    // localVertices: global ids of this rank's vertices, in increasing order
+    MpiCheckpointWriter(const CheckpointOptions& options, int n, const std::vector<int>& localVertices) : path(options.path), interval(options.interval) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        localN = localVertices.size();
+        if (interval <= 0) {
+            return;
+        }
+
+        MPI_Type_create_indexed_block(localN, 1, localVertices.data(), MPI_DOUBLE, &fileType);
+        MPI_Type_commit(&fileType);
+
+        for (int buffer = 0; buffer < 2; ++buffer) {
+            headers[buffer] = makeCheckpointHeader(n, 1);
+            buffers[buffer].resize(localN);
+        }
+    }
+
+    ~MpiCheckpointWriter() {
+        if (fileType != MPI_DATATYPE_NULL) {
+            MPI_Type_free(&fileType);
+        }
+    }
+
+    MpiCheckpointWriter(const MpiCheckpointWriter&) = delete;
+    MpiCheckpointWriter& operator=(const MpiCheckpointWriter&) = delete;
+
+    // Local values of the snapshot; the other buffer may still be in flight
+    double* beginSnapshot(int superstep, double residual) {
+        snapshotStart = MPI_Wtime();
+        CheckpointHeader& header = headers[current];
+        header.superstep = superstep;
+        std::fill(header.scalars, header.scalars + CHECKPOINT_SCALARS, 0.0);
+        header.scalars[0] = residual;
+        return buffers[current].data();
+    }
+
+    void commitSnapshot() {
+        double waitStart = MPI_Wtime();
+        completeWrite();
+        waitSeconds += MPI_Wtime() - waitStart;
+
+        std::string tmpPath = path + ".tmp";
+        MPI_File_open(MPI_COMM_WORLD, tmpPath.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+        if (rank == 0) {
+            MPI_File_write_at(file, 0, &headers[current], sizeof(CheckpointHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+        MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_DOUBLE, fileType, "native", MPI_INFO_NULL);
+        MPI_File_iwrite_all(file, buffers[current].data(), localN, MPI_DOUBLE, &request);
+        writing = true;
+
+        current = 1 - current;
+        snapshotSeconds += MPI_Wtime() - snapshotStart;
+    }
+
+    void completeWrite() {
+        if (!writing) {
+            return;
+        }
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        MPI_File_close(&file);
+        if (rank == 0 && rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+            std::cerr << "Error writing checkpoint file '" << path << "'" << std::endl;
+        }
+        // Nobody reopens path.tmp before it has been renamed
+        MPI_Barrier(MPI_COMM_WORLD);
+        writing = false;
+        ++written;
+    }
+
+    // Completes the last write and reports the slowest rank's cost
+    void finish() {
+        if (interval <= 0) {
+            return;
+        }
+        double waitStart = MPI_Wtime();
+        completeWrite();
+        double waited = MPI_Wtime() - waitStart;
+        waitSeconds += waited;
+        snapshotSeconds += waited;
+
+        double localSeconds[2] = {snapshotSeconds, waitSeconds};
+        double seconds[2];
+        MPI_Reduce(localSeconds, seconds, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            std::cout << "Checkpoints: " << written << " every " << interval << " supersteps to " << path << ", "
+                      << seconds[0] * 1000.0 << " ms on the critical path (" << seconds[1] * 1000.0 << " ms waiting for MPI-IO)" << std::endl;
+        }
+        interval = 0;
+    }
+};
+
+// Reads this rank's values of a checkpoint written by MpiCheckpointWriter
+inline void readCheckpointMpi(const std::string& path, int n, const std::vector<int>& localVertices, CheckpointHeader& header, std::vector<double>& values) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        if (rank == 0) {
+            std::cerr << "Error opening checkpoint file '" << path << "'" << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    header = {};
+    MPI_File_read_at_all(file, 0, &header, sizeof(CheckpointHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_Offset fileSize;
+    MPI_File_get_size(file, &fileSize);
+    // Every rank read the same header and size, so all of them reach the same
+    // verdict and none is left waiting in a collective
+    std::string error = checkpointHeaderError(header, n, 1, path);
+    if (error.empty() && (size_t)fileSize < sizeof(CheckpointHeader) + (size_t)n * sizeof(double)) {
+        error = "'" + path + "' is truncated";
+    }
+    if (!error.empty()) {
+        if (rank == 0) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        MPI_File_close(&file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Datatype fileType;
+    int localN = localVertices.size();
+    MPI_Type_create_indexed_block(localN, 1, localVertices.data(), MPI_DOUBLE, &fileType);
+    MPI_Type_commit(&fileType);
+
+    values.resize(localN);
+    MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_DOUBLE, fileType, "native", MPI_INFO_NULL);
+    MPI_File_read_all(file, values.data(), localN, MPI_DOUBLE, MPI_STATUS_IGNORE);
+
+    MPI_Type_free(&fileType);
+    MPI_File_close(&file);
+}
@@ -1,51 +1,31 @@
 #include <mpi.h>
+#include <omp.h>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <string>
-#include <numeric>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <type_traits>
+
+#include "../common/checkpoint.h"
+#include "../common/combiner.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "checkpoint_mpi.h"
+#include "partition.h"
+#include "routes.h"
 
 using namespace std;
 using namespace std::chrono;
 
 const double DAMPING = 0.85;
 
-void loadInput(const string& filename, unordered_map<string,int>& pageIds, vector<string>& pageNames, vector<vector<int>>& outEdges, vector<vector<int>>& inEdges) {
-    ifstream file(filename);
-    string line, word;
-
-    auto getId = [&](const string& s) {
-        if (!pageIds.count(s)) {
-            int idx = pageIds.size();
-            pageIds[s] = idx;
-            pageNames.push_back(s);
-            outEdges.emplace_back();
-            inEdges.emplace_back();
-        }
-        return pageIds[s];
-    };
-
-    int u, v;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        ss >> word;
-        u = getId(word);
-
-        while (ss >> word) {
-            v = getId(word);
-            outEdges[u].push_back(v);
-            inEdges[v].push_back(u);
-        }
-    }
-}
-
-void generateOutput(const string& filename, const vector<double>& pageRanks, const vector<string>& pageNames, long long executionTime) {
+void generateOutput(const string& filename, const vector<double>& pageRanks, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime) {
     ofstream outFile(filename);
 
-    outFile << executionTime << endl;
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << endl;
     for (size_t i = 0; i < pageRanks.size(); ++i) {
         outFile << pageNames[i] << " " << pageRanks[i] << endl;
     }
@@ -53,157 +33,261 @@ void generateOutput(const string& filename, const vector<double>& pageRanks, con
     outFile.close();
 }
 
-vector<double> rankPages(unordered_map<string,int>& pageIds, vector<string>& pageNames, vector<vector<int>>& outEdges, vector<vector<int>>& inEdges, int maxSupersteps) {
+// Ranks and exchanged messages are stored as Rank (float or double), messages
+// are combined with Combiner (in double for PageRank's sum) and reductions
+// are accumulated in double. Local messages, send slots and received slots
+// are all folded with the combiner, so another combiner only changes how a
+// vertex's messages are aggregated. The ranks are the whole superstep state,
+// so a checkpoint holds only them and the residual.
+template <typename Rank, typename Combiner = SumCombiner<double>>
+vector<Rank> rankPages(Graph& graph, const string& binaryInputFile, PartitionStrategy strategy, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     int n = 0;
     if (rank == 0) {
-        n = pageIds.size();
+        n = graph.n;
     } 
     MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    int verticesPerProcess = (n + size - 1) / size;
-    int verticiesStart = rank * verticesPerProcess;
-    int verticiesEnd = min(verticiesStart + verticesPerProcess, n);
-    int localN = max(0, verticiesEnd - verticiesStart);
+    Partition partition;
+    buildPartition(graph, strategy, n, rank, size, partition);
+    int localN = partition.vertexCounts[rank];
 
-    vector<vector<int>> localOutEdges(localN);
-    vector<vector<int>> localInEdges(localN);
+    // Out-edges of the local vertices, targets keep their global ids
+    Graph localGraph;
+    distributeGraph(graph, partition, binaryInputFile, n, rank, size, localGraph);
 
-    // Distribute graph partitions
-    if (rank == 0) {
-        for (int process = 1; process < size; ++process) {
-            int processStart = process * verticesPerProcess;
-            int processEnd   = min(processStart + verticesPerProcess, n);
-            int processVertexCount = max(0, processEnd - processStart);
+    MessageRoutes routes;
+    buildMessageRoutes(localGraph.n, localGraph.offsets, localGraph.edges, partition, rank, size, routes);
+    reportPartition(partition, localGraph, routes, rank, size);
 
-            MPI_Send(&processVertexCount, 1, MPI_INT, process, 0, MPI_COMM_WORLD);
-
-            for (int u = processStart; u < processEnd; ++u) {
-                int edgeCount = outEdges[u].size();
-                MPI_Send(&edgeCount, 1, MPI_INT, process, 0, MPI_COMM_WORLD);
-                MPI_Send(outEdges[u].data(), edgeCount, MPI_INT, process, 0, MPI_COMM_WORLD);
+    // PageRank algorithm
+    MPI_Datatype rankType = is_same<Rank, float>::value ? MPI_FLOAT : MPI_DOUBLE;
+
+    vector<Rank> localPageRanks(localN, 1.0 / n);
+    vector<Rank> nextLocalPageRanks(localN, 0.0);
+    vector<Rank> shares(localN, 0.0);
+    vector<double> localInbox(localN, 0.0);
+    vector<Rank> sendBuffer(routes.slotOffsets.size() - 1, 0.0);
+    vector<Rank> recvBuffer(routes.recvTargets.size(), 0.0);
+    int slotCount = sendBuffer.size();
+
+    double localResidual = 0.0;
+    bool residualPending = false;
+
+    supersteps = 0;
+    residual = 0.0;
+
+    vector<int> localVertices = partition.localVertices(rank, n);
+    bool converged = false;
+    if (checkpoints.resume) {
+        CheckpointHeader header;
+        vector<double> values;
+        readCheckpointMpi(checkpoints.path, n, localVertices, header, values);
+        copyFromCheckpoint(values.data(), localN, localPageRanks.data());
+        supersteps = header.superstep;
+        residual = header.scalars[0];
+        converged = supersteps > 0 && residual < epsilon;
+    }
+    int firstStep = supersteps;
+    MpiCheckpointWriter checkpointWriter(checkpoints, n, localVertices);
 
-                edgeCount = inEdges[u].size();
-                MPI_Send(&edgeCount, 1, MPI_INT, process, 0, MPI_COMM_WORLD);
-                MPI_Send(inEdges[u].data(), edgeCount, MPI_INT, process, 0, MPI_COMM_WORLD);
-            }
-        }
+    for (int step = firstStep; step < maxSupersteps && !converged; ++step) {
+        bool messagesSent = false;
+        double localDangling = 0.0;
 
+        #pragma omp parallel for reduction(|:messagesSent) reduction(+:localDangling)
         for (int i = 0; i < localN; ++i) {
-            localOutEdges[i] = outEdges[verticiesStart + i];
-            localInEdges[i]  = inEdges[verticiesStart + i];
+            int degree = localGraph.offsets[i + 1] - localGraph.offsets[i];
+            if (degree == 0) {
+                shares[i] = 0.0;
+                localDangling += localPageRanks[i];
+            } else {
+                shares[i] = localPageRanks[i] / degree;
+                messagesSent = true;
+            }
         }
-    } else {
-        MPI_Recv(&localN, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        localOutEdges.resize(localN);
-        localInEdges.resize(localN);
 
-        for (int i = 0; i < localN; ++i) {
-            int edgeCount;
-            MPI_Recv(&edgeCount, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            localOutEdges[i].resize(edgeCount);
-            MPI_Recv(localOutEdges[i].data(), edgeCount, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-            MPI_Recv(&edgeCount, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            localInEdges[i].resize(edgeCount);
-            MPI_Recv(localInEdges[i].data(), edgeCount, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int slot = 0; slot < slotCount; ++slot) {
+            double combined = Combiner::identity();
+            for (int k = routes.slotOffsets[slot]; k < routes.slotOffsets[slot + 1]; ++k) {
+                combined = Combiner::combine(combined, shares[routes.slotSources[k]]);
+            }
+            sendBuffer[slot] = combined;
         }
-    }
-
-    // PageRank algorithm
-    vector<double> localPageRanks(localN, 1.0 / n);
-    vector<double> nextLocalPageRanks(localN, 0.0);
-    vector<double> messages(n, 0.0);
 
-    bool messagesSent = true;
-
-    for (int step = 0; step < maxSupersteps && messagesSent; ++step) {
-        messagesSent = false;
-        fill(nextLocalPageRanks.begin(), nextLocalPageRanks.end(), 0.0);
-        fill(messages.begin(), messages.end(), 0.0);
+        // One combined reduction per superstep: this step's dangling mass and
+        // halt flag, and the residual of the previous step. Only the master
+        // thread talks to MPI (MPI_THREAD_FUNNELED).
+        double localTotals[3] = {localDangling, messagesSent ? 1.0 : 0.0, localResidual};
+        double totals[3];
+        MPI_Request requests[2];
+        MPI_Ialltoallv(sendBuffer.data(), routes.sendCounts.data(), routes.sendDisplacements.data(), rankType,
+                       recvBuffer.data(), routes.recvCounts.data(), routes.recvDisplacements.data(), rankType, MPI_COMM_WORLD, &requests[0]);
+        MPI_Iallreduce(localTotals, totals, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &requests[1]);
+
+        // Combine local messages while the remote ones are in flight, testing
+        // between blocks so the exchange keeps progressing
+        for (int blockStart = 0; blockStart < localN; blockStart += OVERLAP_BLOCK) {
+            int blockEnd = min(blockStart + OVERLAP_BLOCK, localN);
+
+            #pragma omp parallel for schedule(dynamic, 256)
+            for (int i = blockStart; i < blockEnd; ++i) {
+                double inbox = Combiner::identity();
+                for (int k = routes.localOffsets[i]; k < routes.localOffsets[i + 1]; ++k) {
+                    inbox = Combiner::combine(inbox, shares[routes.localSources[k]]);
+                }
+                localInbox[i] = inbox;
+            }
 
-        double localDangling = 0.0;
+            int done;
+            MPI_Testall(2, requests, &done, MPI_STATUSES_IGNORE);
+        }
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
 
-        for (int i = 0; i < localN; ++i) {
-            if (localOutEdges[i].empty()) {
-                localDangling += localPageRanks[i];
-            } else {
-                double share = localPageRanks[i] / localOutEdges[i].size();
-                for (int u : localOutEdges[i]) {
-                    messages[u] += share;
-                } 
-                messagesSent = true;
+        if (residualPending) {
+            residual = totals[2];
+            residualPending = false;
+            if (residual < epsilon) {
+                break;
             }
         }
 
-        MPI_Allreduce(MPI_IN_PLACE, messages.data(), n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        // The ranks are still those of superstep step, whose residual is now known
+        if (checkpoints.due(step) && step > firstStep) {
+            double* values = checkpointWriter.beginSnapshot(step, residual);
+            copyToCheckpoint(localPageRanks.data(), localN, values);
+            checkpointWriter.commitSnapshot();
+        }
 
-        double danglingMass = 0.0;
-        MPI_Allreduce(&localDangling, &danglingMass, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-        double danglingShare = DAMPING * danglingMass / n;
+        double danglingShare = DAMPING * totals[0] / n;
 
+        localResidual = 0.0;
+        #pragma omp parallel for reduction(+:localResidual)
         for (int i = 0; i < localN; ++i) {
-            int v = verticiesStart + i;
-            nextLocalPageRanks[i] = (1.0 - DAMPING)/n + DAMPING * messages[v] + danglingShare;
+            double inbox = localInbox[i];
+            for (int k = routes.recvOffsets[i]; k < routes.recvOffsets[i + 1]; ++k) {
+                inbox = Combiner::combine(inbox, recvBuffer[routes.recvSlots[k]]);
+            }
+
+            nextLocalPageRanks[i] = (1.0 - DAMPING)/n + DAMPING * inbox + danglingShare;
+            localResidual += fabs(nextLocalPageRanks[i] - localPageRanks[i]);
         }
 
         localPageRanks.swap(nextLocalPageRanks);
+        supersteps = step + 1;
+        residualPending = true;
 
-        int anyMessage = messagesSent ? 1 : 0;
-        MPI_Allreduce(MPI_IN_PLACE, &anyMessage, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
-        messagesSent = anyMessage;
+        if (totals[1] == 0.0) {
+            break;
+        }
     }
 
-    vector<double> pageRanks(n, 0.0);
-    vector<int> counts(size), displacements(size);
-    for (int i = 0; i < size; ++i) {
-        int start = i * verticesPerProcess;
-        int end = min(start + verticesPerProcess, n);
-        counts[i] = end - start;
-        displacements[i] = start;
+    // The last step's residual has not been folded into a later reduction
+    if (residualPending) {
+        MPI_Allreduce(&localResidual, &residual, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
     }
+    if (checkpoints.due(supersteps) && supersteps > firstStep) {
+        double* values = checkpointWriter.beginSnapshot(supersteps, residual);
+        copyToCheckpoint(localPageRanks.data(), localN, values);
+        checkpointWriter.commitSnapshot();
+    }
+    checkpointWriter.finish();
 
-    MPI_Gatherv(localPageRanks.data(), localN, MPI_DOUBLE, pageRanks.data(), counts.data(), displacements.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
-
-    return pageRanks;
+    return gatherVertexValues(partition, localPageRanks, rankType, n, rank, size);
 }
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    int threadSupport;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &threadSupport);
 
-    int rank;
+    int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     if (argc < 2) {
         if(rank == 0) {
-            cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS>" << endl;
+            cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--epsilon <EPSILON>] [--input <GRAPH_FILE>] [--partition vertex|edge|hash|ldg] [--threads <THREADS_PER_PROCESS>] [--precision double|float] [--checkpoint <SUPERSTEPS>] [--checkpoint-file <PATH>] [--resume]" << endl;
         }
         MPI_Finalize();
         return 1;
     }
     int maxSupersteps = atoi(argv[1]);
 
-    unordered_map<string,int> pageIds;
-    vector<string> pageNames;
-    vector<vector<int>> outEdges;
-    vector<vector<int>> inEdges;
+    string inputFile = "/app/input/graph.txt";
+    double epsilon = 0.0;
+    PartitionStrategy strategy = VERTEX_RANGES;
+    bool singlePrecision = false;
+    CheckpointOptions checkpoints;
+    checkpoints.path = "/app/output/distributed.checkpoint";
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--partition" && i + 1 < argc) {
+            strategy = parsePartitionStrategy(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            omp_set_num_threads(max(1, atoi(argv[++i])));
+        } else if (arg == "--precision" && i + 1 < argc) {
+            singlePrecision = string(argv[++i]) == "float";
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoints.interval = max(0, atoi(argv[++i]));
+        } else if (arg == "--checkpoint-file" && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (arg == "--resume") {
+            checkpoints.resume = true;
+        }
+    }
+
+    // Hybrid mode runs one rank per node or socket with OpenMP threads
+    // inside it, which needs MPI to tolerate threads around the master
+    if (threadSupport < MPI_THREAD_FUNNELED && omp_get_max_threads() > 1) {
+        if (rank == 0) {
+            cerr << "Warning: MPI does not support MPI_THREAD_FUNNELED, running with 1 thread per process" << endl;
+        }
+        omp_set_num_threads(1);
+    }
+    if (rank == 0) {
+        cout << "Running " << size << " processes x " << omp_get_max_threads() << " threads" << endl;
+    }
+
+    PageNames pageNames;
+    Graph graph;
+
+    long long loadTime = 0;
+    string binaryInputFile = isBinaryGraph(inputFile) ? inputFile : "";
 
+    // Rank 0 needs the names for the output; with a binary graph this is
+    // only a mapping, the other ranks map their own slice in rankPages
     if (rank == 0) {
-        string inputFile = "/app/input/graph.txt";
-        loadInput(inputFile, pageIds, pageNames, outEdges, inEdges);
+        auto loadStart = high_resolution_clock::now();
+        loadGraph(inputFile, pageNames, graph);
+        auto loadEnd = high_resolution_clock::now();
+        loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count();
     }
 
+    int supersteps;
+    double residual;
+
     auto start = high_resolution_clock::now();
-    vector<double> pageRanks = rankPages(pageIds, pageNames, outEdges, inEdges, maxSupersteps);
+    vector<double> pageRanks;
+    if (singlePrecision) {
+        vector<float> singlePageRanks = rankPages<float>(graph, binaryInputFile, strategy, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+        pageRanks.assign(singlePageRanks.begin(), singlePageRanks.end());
+    } else {
+        pageRanks = rankPages<double>(graph, binaryInputFile, strategy, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+    }
     auto end = high_resolution_clock::now();
     long long executionTime = duration_cast<milliseconds>(end - start).count();
 
     if (rank == 0) {
-        string outputFile = "/app/output/distributed_" + to_string(maxSupersteps) + ".txt";
-        generateOutput(outputFile, pageRanks, pageNames, executionTime);
+        string outputFile = "/app/output/distributed_" + string(singlePrecision ? "float_" : "") + to_string(maxSupersteps) + ".txt";
+        generateOutput(outputFile, pageRanks, pageNames, executionTime, supersteps, residual, loadTime);
     }
 
     MPI_Finalize();
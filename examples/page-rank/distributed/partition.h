@@ -0,0 +1,328 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../common/binary_graph.h"
+#include "../common/graph.h"
+
+enum PartitionStrategy {
+    VERTEX_RANGES,
+    EDGE_RANGES,
+    HASH_PARTITION,
+    STREAMING_PARTITION
+};
+
+inline PartitionStrategy parsePartitionStrategy(const std::string& name) {
+    if (name == "edge") {
+        return EDGE_RANGES;
+    } else if (name == "hash") {
+        return HASH_PARTITION;
+    } else if (name == "ldg") {
+        return STREAMING_PARTITION;
+    }
+    return VERTEX_RANGES;
+}
+
+inline const char* partitionStrategyName(PartitionStrategy strategy) {
+    switch (strategy) {
+        case EDGE_RANGES: return "edge";
+        case HASH_PARTITION: return "hash";
+        case STREAMING_PARTITION: return "ldg";
+        default: return "vertex";
+    }
+}
+
+// Assignment of vertices to ranks. Range strategies give every rank a
+// contiguous block of ids, the hash and streaming strategies scatter them.
+// Local vertices are always numbered in increasing global id order.
+struct Partition {
+    PartitionStrategy strategy = VERTEX_RANGES;
+    int size = 1;
+    std::vector<int> boundaries;
+    std::vector<int> owners;
+    std::vector<int> localIndices;
+    std::vector<int> vertexCounts;
+
+    bool isRange() const {
+        return strategy == VERTEX_RANGES || strategy == EDGE_RANGES;
+    }
+
+    int owner(int v) const {
+        if (isRange()) {
+            return std::upper_bound(boundaries.begin(), boundaries.end(), v) - boundaries.begin() - 1;
+        } else if (strategy == HASH_PARTITION) {
+            return v % size;
+        }
+        return owners[v];
+    }
+
+    int localIndex(int v) const {
+        if (isRange()) {
+            return v - boundaries[owner(v)];
+        } else if (strategy == HASH_PARTITION) {
+            return v / size;
+        }
+        return localIndices[v];
+    }
+
+    // Global ids of the vertices owned by process, in local order
+    std::vector<int> localVertices(int process, int n) const {
+        std::vector<int> vertices;
+        vertices.reserve(vertexCounts[process]);
+        if (isRange()) {
+            for (int v = boundaries[process]; v < boundaries[process + 1]; ++v) {
+                vertices.push_back(v);
+            }
+        } else if (strategy == HASH_PARTITION) {
+            for (int v = process; v < n; v += size) {
+                vertices.push_back(v);
+            }
+        } else {
+            for (int v = 0; v < n; ++v) {
+                if (owners[v] == process) {
+                    vertices.push_back(v);
+                }
+            }
+        }
+        return vertices;
+    }
+
+    // Global ids of all vertices grouped by owner, the order in which
+    // per-rank data is laid out by Scatterv/Gatherv
+    std::vector<int> packedOrder(int n) const {
+        std::vector<int> order;
+        order.reserve(n);
+        if (isRange()) {
+            for (int v = 0; v < n; ++v) {
+                order.push_back(v);
+            }
+            return order;
+        }
+
+        std::vector<int> position(size + 1, 0);
+        for (int process = 0; process < size; ++process) {
+            position[process + 1] = position[process] + vertexCounts[process];
+        }
+        order.resize(n);
+        for (int v = 0; v < n; ++v) {
+            order[position[owner(v)]++] = v;
+        }
+        return order;
+    }
+};
+
+// Linear deterministic greedy (LDG) streaming partitioner. Vertices are
+// placed in id order on the rank holding most of their already placed
+// neighbours (in and out), scaled by how much room that rank has left.
+// Load is counted as vertices plus out-edges so ranks also balance edges.
+inline void streamingPartition(Graph& graph, int size, std::vector<int>& owners) {
+    int n = graph.n;
+    if (!graph.hasInEdges()) {
+        buildInEdges(graph);
+    }
+
+    double capacity = 1.05 * (double(n) + graph.m) / size + 1.0;
+    std::vector<double> loads(size, 0.0);
+    std::vector<int> neighbours(size, 0);
+    std::vector<int> touched;
+
+    owners.assign(n, -1);
+    for (int v = 0; v < n; ++v) {
+        touched.clear();
+        auto count = [&](int u) {
+            int owner = owners[u];
+            if (owner >= 0) {
+                if (neighbours[owner]++ == 0) {
+                    touched.push_back(owner);
+                }
+            }
+        };
+        for (int i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+            count(graph.edges[i]);
+        }
+        for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+            count(graph.inEdges[i]);
+        }
+
+        int best = 0;
+        double bestScore = -1.0;
+        for (int process = 0; process < size; ++process) {
+            double score = neighbours[process] * (1.0 - loads[process] / capacity);
+            if (score > bestScore || (score == bestScore && loads[process] < loads[best])) {
+                best = process;
+                bestScore = score;
+            }
+        }
+
+        owners[v] = best;
+        loads[best] += 1.0 + graph.outDegree(v);
+        for (int process : touched) {
+            neighbours[process] = 0;
+        }
+    }
+}
+
+// Collective: rank 0 derives the partition from the graph it loaded and
+// broadcasts what the other ranks need to evaluate owner/localIndex
+inline void buildPartition(Graph& graph, PartitionStrategy strategy, int n, int rank, int size, Partition& partition) {
+    partition.strategy = strategy;
+    partition.size = size;
+    partition.vertexCounts.assign(size, 0);
+
+    if (partition.isRange()) {
+        partition.boundaries.assign(size + 1, n);
+        if (strategy == VERTEX_RANGES) {
+            int verticesPerProcess = (n + size - 1) / size;
+            for (int process = 0; process < size; ++process) {
+                partition.boundaries[process] = std::min(process * verticesPerProcess, n);
+            }
+        } else if (rank == 0) {
+            // Vertex v weighs 1 + outdeg(v), so offsets[v] + v is the prefix
+            // weight before v; cut where it crosses each rank's equal share
+            long long total = (long long)n + graph.m;
+            int v = 0;
+            for (int process = 0; process < size; ++process) {
+                long long target = total * process / size;
+                while (v < n && (long long)graph.offsets[v] + v < target) {
+                    ++v;
+                }
+                partition.boundaries[process] = v;
+            }
+        }
+        MPI_Bcast(partition.boundaries.data(), size + 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        for (int process = 0; process < size; ++process) {
+            partition.vertexCounts[process] = partition.boundaries[process + 1] - partition.boundaries[process];
+        }
+        return;
+    }
+
+    if (strategy == HASH_PARTITION) {
+        for (int process = 0; process < size; ++process) {
+            partition.vertexCounts[process] = process < n ? (n - process + size - 1) / size : 0;
+        }
+        return;
+    }
+
+    partition.owners.resize(n);
+    if (rank == 0) {
+        streamingPartition(graph, size, partition.owners);
+    }
+    MPI_Bcast(partition.owners.data(), n, MPI_INT, 0, MPI_COMM_WORLD);
+
+    partition.localIndices.resize(n);
+    for (int v = 0; v < n; ++v) {
+        partition.localIndices[v] = partition.vertexCounts[partition.owners[v]]++;
+    }
+}
+
+// Collective: gives every rank the out-edges of its own vertices in local
+// order, targets keep their global ids. Binary graphs are mapped by each rank
+// (only its own slice for range partitions); text graphs are scattered from
+// rank 0 as per-rank degree and edge blocks.
+inline void distributeGraph(const Graph& graph, const Partition& partition, const std::string& binaryInputFile, int n, int rank, int size, Graph& localGraph) {
+    int localN = partition.vertexCounts[rank];
+
+    if (!binaryInputFile.empty()) {
+        if (partition.isRange()) {
+            mapBinaryGraphSlice(binaryInputFile, partition.boundaries[rank], partition.boundaries[rank + 1], localGraph);
+            return;
+        }
+
+        // Scattered vertices: map the whole file, only the pages holding
+        // this rank's rows are read in
+        Graph fullGraph;
+        PageNames unusedNames;
+        mapBinaryGraph(binaryInputFile, fullGraph, unusedNames);
+
+        localGraph = Graph();
+        localGraph.offsetStorage.assign(1, 0);
+        for (int v : partition.localVertices(rank, n)) {
+            localGraph.edgeStorage.insert(localGraph.edgeStorage.end(), fullGraph.edges + fullGraph.offsets[v], fullGraph.edges + fullGraph.offsets[v + 1]);
+            localGraph.offsetStorage.push_back(localGraph.edgeStorage.size());
+        }
+        localGraph.useStorage();
+        return;
+    }
+
+    std::vector<int> vertexDisplacements(size, 0);
+    for (int process = 1; process < size; ++process) {
+        vertexDisplacements[process] = vertexDisplacements[process - 1] + partition.vertexCounts[process - 1];
+    }
+
+    std::vector<int> degrees;
+    std::vector<int> packedEdges;
+    const int* edgeSource = graph.edges;
+    std::vector<int> edgeCounts(size, 0), edgeDisplacements(size, 0);
+
+    if (rank == 0) {
+        std::vector<int> order = partition.packedOrder(n);
+        degrees.resize(n);
+        for (int k = 0; k < n; ++k) {
+            degrees[k] = graph.outDegree(order[k]);
+        }
+
+        // Range partitions are already packed in the CSR edge array
+        if (!partition.isRange()) {
+            packedEdges.reserve(graph.m);
+            for (int v : order) {
+                packedEdges.insert(packedEdges.end(), graph.edges + graph.offsets[v], graph.edges + graph.offsets[v + 1]);
+            }
+            edgeSource = packedEdges.data();
+        }
+
+        int k = 0;
+        for (int process = 0; process < size; ++process) {
+            edgeDisplacements[process] = process > 0 ? edgeDisplacements[process - 1] + edgeCounts[process - 1] : 0;
+            for (int i = 0; i < partition.vertexCounts[process]; ++i) {
+                edgeCounts[process] += degrees[k++];
+            }
+        }
+    }
+
+    int localM = 0;
+    MPI_Scatter(edgeCounts.data(), 1, MPI_INT, &localM, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    localGraph = Graph();
+    localGraph.offsetStorage.assign(localN + 1, 0);
+    MPI_Scatterv(degrees.data(), partition.vertexCounts.data(), vertexDisplacements.data(), MPI_INT,
+                 localGraph.offsetStorage.data() + 1, localN, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int i = 0; i < localN; ++i) {
+        localGraph.offsetStorage[i + 1] += localGraph.offsetStorage[i];
+    }
+
+    localGraph.edgeStorage.resize(localM);
+    MPI_Scatterv(edgeSource, edgeCounts.data(), edgeDisplacements.data(), MPI_INT,
+                 localGraph.edgeStorage.data(), localM, MPI_INT, 0, MPI_COMM_WORLD);
+
+    localGraph.useStorage();
+}
+
+// Collective: gathers one value per local vertex on rank 0, in vertex id
+// order; the other ranks get an empty vector
+template <typename T>
+std::vector<T> gatherVertexValues(const Partition& partition, const std::vector<T>& localValues, MPI_Datatype type, int n, int rank, int size) {
+    std::vector<T> packedValues(rank == 0 ? n : 0);
+    std::vector<int> displacements(size, 0);
+    for (int process = 1; process < size; ++process) {
+        displacements[process] = displacements[process - 1] + partition.vertexCounts[process - 1];
+    }
+
+    MPI_Gatherv(localValues.data(), partition.vertexCounts[rank], type, packedValues.data(), partition.vertexCounts.data(), displacements.data(), type, 0, MPI_COMM_WORLD);
+
+    if (rank != 0 || partition.isRange()) {
+        return packedValues;
+    }
+
+    // Values arrive grouped by owner, put them back in vertex id order
+    std::vector<int> order = partition.packedOrder(n);
+    std::vector<T> values(n);
+    for (int k = 0; k < n; ++k) {
+        values[order[k]] = packedValues[k];
+    }
+    return values;
+}
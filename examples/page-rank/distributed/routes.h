@@ -0,0 +1,193 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "../common/graph.h"
+#include "partition.h"
+
+// Local vertices combined between two progress tests of the message exchange
+const int OVERLAP_BLOCK = 1 << 16;
+
+// Pregel message routing for one rank. Messages to remote vertices are
+// combined into one send slot per distinct target and exchanged with
+// MPI_Alltoallv, so a rank sends one message per destination vertex however
+// many of its vertices link there. Combining is done as a gather so that
+// OpenMP threads never write the same inbox entry or slot: every local
+// vertex, send slot and received slot's target has the list of sources it
+// sums.
+struct MessageRoutes {
+    std::vector<int> localOffsets;
+    std::vector<int> localSources;
+    std::vector<int> slotOffsets;
+    std::vector<int> slotSources;
+    std::vector<int> recvOffsets;
+    std::vector<int> recvSlots;
+
+    std::vector<int> sendCounts;
+    std::vector<int> sendDisplacements;
+    std::vector<int> recvCounts;
+    std::vector<int> recvDisplacements;
+    std::vector<int> recvTargets;
+
+    int slotCount() const {
+        return slotOffsets.size() - 1;
+    }
+};
+
+// Groups values by key with a counting sort: the values of key k are
+// items[offsets[k]] .. items[offsets[k + 1] - 1], in their original order
+inline void groupByKey(int keyCount, const std::vector<int>& keys, const std::vector<int>& values, std::vector<int>& offsets, std::vector<int>& items) {
+    offsets.assign(keyCount + 1, 0);
+    items.resize(values.size());
+
+    for (int key : keys) {
+        offsets[key + 1]++;
+    }
+    for (int k = 0; k < keyCount; ++k) {
+        offsets[k + 1] += offsets[k];
+    }
+
+    std::vector<int> position(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        items[position[keys[i]]++] = values[i];
+    }
+}
+
+// Collective: routes along the rows localN x offsets/edges of the local
+// vertices, whose targets are global ids (the out-edges of distributeGraph,
+// or the in-edges of distributeInEdges to send against the edge direction)
+inline void buildMessageRoutes(int localN, const int* offsets, const int* edges, const Partition& partition, int rank, int size, MessageRoutes& routes) {
+    int localM = offsets[localN];
+    std::vector<std::vector<int>> remoteTargets(size);
+    for (int j = 0; j < localM; ++j) {
+        int v = edges[j];
+        int owner = partition.owner(v);
+        if (owner != rank) {
+            remoteTargets[owner].push_back(v);
+        }
+    }
+
+    routes.sendCounts.assign(size, 0);
+    routes.sendDisplacements.assign(size, 0);
+    for (int process = 0; process < size; ++process) {
+        std::vector<int>& targets = remoteTargets[process];
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+        routes.sendCounts[process] = targets.size();
+        if (process > 0) {
+            routes.sendDisplacements[process] = routes.sendDisplacements[process - 1] + routes.sendCounts[process - 1];
+        }
+    }
+    int slotCount = routes.sendDisplacements[size - 1] + routes.sendCounts[size - 1];
+
+    std::vector<int> localTargets, localSources, slots, slotSources;
+    for (int i = 0; i < localN; ++i) {
+        for (int j = offsets[i]; j < offsets[i + 1]; ++j) {
+            int v = edges[j];
+            int owner = partition.owner(v);
+            if (owner == rank) {
+                localTargets.push_back(partition.localIndex(v));
+                localSources.push_back(i);
+            } else {
+                const std::vector<int>& targets = remoteTargets[owner];
+                slots.push_back(routes.sendDisplacements[owner] + (std::lower_bound(targets.begin(), targets.end(), v) - targets.begin()));
+                slotSources.push_back(i);
+            }
+        }
+    }
+    groupByKey(localN, localTargets, localSources, routes.localOffsets, routes.localSources);
+    groupByKey(slotCount, slots, slotSources, routes.slotOffsets, routes.slotSources);
+
+    routes.recvCounts.assign(size, 0);
+    MPI_Alltoall(routes.sendCounts.data(), 1, MPI_INT, routes.recvCounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    routes.recvDisplacements.assign(size, 0);
+    for (int process = 1; process < size; ++process) {
+        routes.recvDisplacements[process] = routes.recvDisplacements[process - 1] + routes.recvCounts[process - 1];
+    }
+
+    std::vector<int> sendVertices;
+    for (const std::vector<int>& targets : remoteTargets) {
+        sendVertices.insert(sendVertices.end(), targets.begin(), targets.end());
+    }
+
+    routes.recvTargets.resize(routes.recvDisplacements[size - 1] + routes.recvCounts[size - 1]);
+    MPI_Alltoallv(sendVertices.data(), routes.sendCounts.data(), routes.sendDisplacements.data(), MPI_INT,
+                  routes.recvTargets.data(), routes.recvCounts.data(), routes.recvDisplacements.data(), MPI_INT, MPI_COMM_WORLD);
+
+    for (int& v : routes.recvTargets) {
+        v = partition.localIndex(v);
+    }
+
+    std::vector<int> recvSlots(routes.recvTargets.size());
+    std::iota(recvSlots.begin(), recvSlots.end(), 0);
+    groupByKey(localN, routes.recvTargets, recvSlots, routes.recvOffsets, routes.recvSlots);
+}
+
+// Collective: fills localGraph.inOffsets/inEdges with the in-edges of the
+// local vertices, sources as global ids, by sending every out-edge to the
+// owner of its target
+inline void distributeInEdges(Graph& localGraph, const Partition& partition, int n, int rank, int size) {
+    std::vector<int> localVertices = partition.localVertices(rank, n);
+
+    std::vector<int> sendCounts(size, 0), sendDisplacements(size, 0), recvCounts(size), recvDisplacements(size, 0);
+    for (int j = 0; j < localGraph.m; ++j) {
+        sendCounts[partition.owner(localGraph.edges[j])] += 2;
+    }
+    for (int process = 1; process < size; ++process) {
+        sendDisplacements[process] = sendDisplacements[process - 1] + sendCounts[process - 1];
+    }
+
+    // (target local index, source global id) pairs grouped by target owner
+    std::vector<int> pairs(2 * (size_t)localGraph.m);
+    std::vector<int> position(sendDisplacements);
+    for (int i = 0; i < localGraph.n; ++i) {
+        for (int j = localGraph.offsets[i]; j < localGraph.offsets[i + 1]; ++j) {
+            int v = localGraph.edges[j];
+            int& slot = position[partition.owner(v)];
+            pairs[slot++] = partition.localIndex(v);
+            pairs[slot++] = localVertices[i];
+        }
+    }
+
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int process = 1; process < size; ++process) {
+        recvDisplacements[process] = recvDisplacements[process - 1] + recvCounts[process - 1];
+    }
+    std::vector<int> received(recvDisplacements[size - 1] + recvCounts[size - 1]);
+    MPI_Alltoallv(pairs.data(), sendCounts.data(), sendDisplacements.data(), MPI_INT,
+                  received.data(), recvCounts.data(), recvDisplacements.data(), MPI_INT, MPI_COMM_WORLD);
+
+    std::vector<int> targets(received.size() / 2), sources(received.size() / 2);
+    for (size_t k = 0; k < targets.size(); ++k) {
+        targets[k] = received[2 * k];
+        sources[k] = received[2 * k + 1];
+    }
+    groupByKey(localGraph.n, targets, sources, localGraph.inOffsets, localGraph.inEdges);
+}
+
+// Rank 0 prints how many vertices and edges each rank owns and how many of
+// those edges cross to another rank
+inline void reportPartition(const Partition& partition, const Graph& localGraph, const MessageRoutes& routes, int rank, int size) {
+    int localStats[2] = {localGraph.m, int(routes.slotSources.size())};
+    std::vector<int> stats(rank == 0 ? 2 * size : 0);
+    MPI_Gather(localStats, 2, MPI_INT, stats.data(), 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        long long totalEdges = 0, totalCut = 0;
+        for (int process = 0; process < size; ++process) {
+            totalEdges += stats[2 * process];
+            totalCut += stats[2 * process + 1];
+            std::cout << "Partition " << partitionStrategyName(partition.strategy) << " rank " << process
+                      << ": vertices " << partition.vertexCounts[process] << " edges " << stats[2 * process]
+                      << " cut " << stats[2 * process + 1] << std::endl;
+        }
+        std::cout << "Partition " << partitionStrategyName(partition.strategy) << ": cut " << totalCut << " of " << totalEdges << " edges" << std::endl;
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <sched.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/graph.h"
+
+// Allocator whose construct() default-initializes, so resizing a vector of
+// numbers reserves the pages without touching them. The first write then
+// places each page on the NUMA node of the thread that makes it.
+template <typename T>
+struct UninitializedAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = UninitializedAllocator<U>;
+    };
+
+    UninitializedAllocator() = default;
+
+    template <typename U>
+    UninitializedAllocator(const UninitializedAllocator<U>&) {}
+
+    template <typename U>
+    void construct(U* p) {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using NumaVector = std::vector<T, UninitializedAllocator<T>>;
+
+// Sizes values to n and writes value into it, either from the main thread or
+// in parallel with the static schedule of the superstep loops, so that with
+// firstTouch every thread owns the pages of the vertices it computes
+template <typename T>
+void initialize(NumaVector<T>& values, int n, T value, bool firstTouch) {
+    values.resize(n);
+    if (firstTouch) {
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < n; ++v) {
+            values[v] = value;
+        }
+    } else {
+        std::fill(values.begin(), values.end(), value);
+    }
+}
+
+// CSR arrays read by the superstep loops, pointing either into the loaded
+// Graph or into a PlacedGraph
+struct GraphView {
+    int n = 0;
+    const int* offsets = nullptr;
+    const int* edges = nullptr;
+    const int* inOffsets = nullptr;
+    const int* inEdges = nullptr;
+
+    int outDegree(int v) const {
+        return offsets[v + 1] - offsets[v];
+    }
+};
+
+inline GraphView viewGraph(const Graph& graph) {
+    GraphView view;
+    view.n = graph.n;
+    view.offsets = graph.offsets;
+    view.edges = graph.edges;
+    view.inOffsets = graph.inOffsets.data();
+    view.inEdges = graph.inEdges.data();
+    return view;
+}
+
+// Copy of the CSR (and CSC, when built) in which every row is first-touched
+// by the thread that owns its vertex under the static schedule. Threads are
+// laid out node by node, so each node ends up holding the slice of the graph
+// its own threads traverse.
+struct PlacedGraph {
+    NumaVector<int> offsets;
+    NumaVector<int> edges;
+    NumaVector<int> inOffsets;
+    NumaVector<int> inEdges;
+
+    GraphView view(int n) const {
+        GraphView view;
+        view.n = n;
+        view.offsets = offsets.data();
+        view.edges = edges.data();
+        view.inOffsets = inOffsets.empty() ? nullptr : inOffsets.data();
+        view.inEdges = inEdges.empty() ? nullptr : inEdges.data();
+        return view;
+    }
+};
+
+inline void placeRows(int n, const int* sourceOffsets, const int* sourceEdges, int m, NumaVector<int>& offsets, NumaVector<int>& edges) {
+    offsets.resize(n + 1);
+    edges.resize(m);
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; ++v) {
+        offsets[v] = sourceOffsets[v];
+        std::copy(sourceEdges + sourceOffsets[v], sourceEdges + sourceOffsets[v + 1], edges.begin() + sourceOffsets[v]);
+    }
+    offsets[n] = sourceOffsets[n];
+}
+
+inline void placeGraph(const Graph& graph, PlacedGraph& placed) {
+    placeRows(graph.n, graph.offsets, graph.edges, graph.m, placed.offsets, placed.edges);
+    if (graph.hasInEdges()) {
+        placeRows(graph.n, graph.inOffsets.data(), graph.inEdges.data(), graph.m, placed.inOffsets, placed.inEdges);
+    }
+}
+
+// Parses a sysfs cpu list such as "0-3,8-11"
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// CPUs of every NUMA node with CPUs, or a single node holding all CPUs when
+// the topology is not exposed
+inline std::vector<std::vector<int>> readNodeCpus() {
+    std::vector<std::vector<int>> nodeCpus;
+    for (int node = 0; ; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file) {
+            break;
+        }
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus = parseCpuList(list);
+        if (!cpus.empty()) {
+            nodeCpus.push_back(cpus);
+        }
+    }
+
+    if (nodeCpus.empty()) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        sched_getaffinity(0, sizeof(mask), &mask);
+        nodeCpus.emplace_back();
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) {
+                nodeCpus[0].push_back(cpu);
+            }
+        }
+    }
+    return nodeCpus;
+}
+
+// Pins the threads of the OpenMP team to the CPUs of the given nodes. Thread
+// t goes to node t * nodes / threads, so the contiguous vertex blocks of the
+// static schedule, and the pages they first-touch, stay on one node.
+inline void pinThreads(const std::vector<std::vector<int>>& nodeCpus) {
+    int nodes = nodeCpus.size();
+
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int node = (long long)thread * nodes / threads;
+        int firstThread = (node * threads + nodes - 1) / nodes;
+        const std::vector<int>& cpus = nodeCpus[node];
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpus[(thread - firstThread) % cpus.size()], &mask);
+        sched_setaffinity(0, sizeof(mask), &mask);
+    }
+}
@@ -1,48 +1,42 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <string>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 #include <omp.h>
 
+#include "../common/checkpoint.h"
+#include "../common/frontier.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "../common/reorder.h"
+#include "numa.h"
+#include "schedule.h"
+
 using namespace std;
 using namespace std::chrono;
 
 const double DAMPING = 0.85;
 
-void loadInput(const string& filename, unordered_map<string, int>& pageIds, vector<string>& pageNames, vector<vector<int>>& outEdges) {
-    ifstream file(filename);
-    string line, word;
-
-    auto getId = [&](const string& s) {
-        if (!pageIds.count(s)) {
-            int idx = pageIds.size();
-            pageIds[s] = idx;
-            pageNames.push_back(s);
-            outEdges.emplace_back();
-        }
-        return pageIds[s];
-    };
+// Vertices per chunk the priority order of the asynchronous mode sorts
+const int ASYNC_CHUNK = 256;
 
-    int v, u;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        ss >> word;
-        u = getId(word);
+void computeInverseOutDegrees(const GraphView& graph, NumaVector<double>& inverseOutDegrees) {
+    inverseOutDegrees.resize(graph.n);
 
-        while (ss >> word) {
-            v = getId(word);
-            outEdges[u].push_back(v);
-        }
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < graph.n; ++v) {
+        int degree = graph.outDegree(v);
+        inverseOutDegrees[v] = degree > 0 ? 1.0 / degree : 0.0;
     }
 }
 
-void generateOutput(const string& filename, const vector<double>& pageRanks, const vector<string>& pageNames, long long executionTime) {
+void generateOutput(const string& filename, const vector<double>& pageRanks, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime, long long reorderTime) {
     ofstream outFile(filename);
 
-    outFile << executionTime << endl;
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << " " << reorderTime << endl;
     for (size_t i = 0; i < pageRanks.size(); ++i) {
         outFile << pageNames[i] << " " << pageRanks[i] << endl;
     }
@@ -50,78 +44,758 @@ void generateOutput(const string& filename, const vector<double>& pageRanks, con
     outFile.close();
 }
 
-vector<double> rankPages(unordered_map<string, int>& pageIds, vector<string>& pageNames, vector<vector<int>>& outEdges, int maxSupersteps) {
-    int n = pageIds.size();
+// Ranks and messages are stored as Rank (float or double), per-vertex sums
+// and reductions are accumulated in double. The other vertex loops use the
+// static schedule, which firstTouch initialization mirrors and the vertex
+// plan's equal blocks approximate. A checkpoint holds the ranks and the inbox.
+template <typename Rank>
+vector<Rank> rankPages(const GraphView& graph, const NumaVector<double>& inverseOutDegrees, bool pullMode, bool firstTouch, const LoopPlan& plan, bool reportThreads, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
 
-    vector<double> pageRanks(n, 1.0 / n);
-    vector<double> nextPageRanks(n, 0.0);
-    vector<double> inbox(n, 0.0);
-    vector<double> outbox(n, 0.0);
+    NumaVector<Rank> pageRanks, nextPageRanks, inbox, outbox;
+    initialize<Rank>(pageRanks, n, 1.0 / n, firstTouch);
+    initialize<Rank>(nextPageRanks, n, 0.0, firstTouch);
+    initialize<Rank>(inbox, n, 0.0, firstTouch);
+    initialize<Rank>(outbox, n, 0.0, firstTouch);
 
     double danglingMass;
     bool messagesSent = true;
+    bool converged = false;
 
     int numThreads = omp_get_max_threads();
+    int numBlocks = plan.threadBoundaries.empty() ? 0 : plan.threadBoundaries.size() - 1;
+    vector<double> busyTimes(numThreads, 0.0);
+    vector<double> idleTimes(numThreads, 0.0);
 
-    for (int step = 0; step < maxSupersteps && messagesSent; ++step) {
+    // Rows the vertex loop traverses: in-edges when pulling, out-edges when pushing
+    const int* rowOffsets = pullMode ? graph.inOffsets : graph.offsets;
+
+    supersteps = 0;
+    residual = 0.0;
+
+    if (checkpoints.resume) {
+        Checkpoint checkpoint;
+        readCheckpoint(checkpoints.path, n, 2, checkpoint);
+        copyFromCheckpoint(checkpoint.vector(0), n, pageRanks.data());
+        copyFromCheckpoint(checkpoint.vector(1), n, inbox.data());
+        supersteps = checkpoint.header.superstep;
+        residual = checkpoint.header.scalars[0];
+        converged = supersteps > 0 && residual < epsilon;
+    }
+    CheckpointWriter checkpointWriter(checkpoints, n, 2);
+
+    for (int step = supersteps; step < maxSupersteps && messagesSent && !converged; ++step) {
         danglingMass = 0.0;
         messagesSent = false;
 
-        fill(outbox.begin(), outbox.end(), 0.0);
+        // Raw pointers, so the loop body does not reload them from the vectors
+        const Rank* ranks = pageRanks.data();
+        const Rank* received = inbox.data();
+        Rank* nextRanks = nextPageRanks.data();
+        Rank* sending = outbox.data();
+        const double* inverseDegrees = inverseOutDegrees.data();
 
-        #pragma omp parallel for reduction(|:messagesSent) reduction(+:danglingMass)
-        for (int v = 0; v < n; ++v) {
-            double sum = inbox[v];
-            nextPageRanks[v] = (1.0 - DAMPING) / n + DAMPING * sum;
+        // Vertices first .. last - 1 with all their edges
+        auto processVertices = [=](int first, int last, double& dangling, bool& sent) {
+            if (pullMode) {
+                // Gather over in-edges, each thread writes only the vertices it owns
+                for (int v = first; v < last; ++v) {
+                    double sum = received[v];
+                    nextRanks[v] = (1.0 - DAMPING) / n + DAMPING * sum;
+
+                    if (graph.outDegree(v) == 0) {
+                        dangling += ranks[v];
+                    }
+
+                    double gathered = 0.0;
+                    for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+                        int u = graph.inEdges[i];
+                        gathered += ranks[u] * inverseDegrees[u];
+                        sent = true;
+                    }
+                    sending[v] = gathered;
+                }
+            } else {
+                for (int v = first; v < last; ++v) {
+                    double sum = received[v];
+                    nextRanks[v] = (1.0 - DAMPING) / n + DAMPING * sum;
+
+                    int start = graph.offsets[v];
+                    int end = graph.offsets[v + 1];
+
+                    if (start == end) {
+                        dangling += ranks[v];
+                    } else {
+                        double share = ranks[v] / (end - start);
+                        for (int i = start; i < end; ++i) {
+                            int u = graph.edges[i];
+                            #pragma omp atomic
+                            sending[u] += Rank(share);
+                            sent = true;
+                        }
+                    }
+                }
+            }
+        };
+
+        // Edges edgeBegin .. edgeEnd - 1 of a vertex split across tasks; the
+        // piece holding its first edge also computes the vertex's own rank
+        auto processPiece = [=](int v, int edgeBegin, int edgeEnd, double& dangling, bool& sent) {
+            if (edgeBegin == rowOffsets[v]) {
+                double sum = received[v];
+                nextRanks[v] = (1.0 - DAMPING) / n + DAMPING * sum;
+
+                if (graph.outDegree(v) == 0) {
+                    dangling += ranks[v];
+                }
+            }
 
-            if (outEdges[v].empty()) {
-                danglingMass += pageRanks[v];
+            if (pullMode) {
+                double gathered = 0.0;
+                for (int i = edgeBegin; i < edgeEnd; ++i) {
+                    int u = graph.inEdges[i];
+                    gathered += ranks[u] * inverseDegrees[u];
+                }
+                #pragma omp atomic
+                sending[v] += Rank(gathered);
             } else {
-                double share = pageRanks[v] / outEdges[v].size();
-                for (int u : outEdges[v]) {
+                double share = ranks[v] / graph.outDegree(v);
+                for (int i = edgeBegin; i < edgeEnd; ++i) {
+                    int u = graph.edges[i];
                     #pragma omp atomic
-                    outbox[u] += share;
-                    messagesSent = true;
+                    sending[u] += Rank(share);
+                }
+            }
+            sent = true;
+        };
+
+        if (!pullMode) {
+            #pragma omp parallel for schedule(static)
+            for (int v = 0; v < n; ++v) {
+                outbox[v] = 0.0;
+            }
+        } else {
+            for (int v : plan.splitVertices) {
+                outbox[v] = 0.0;
+            }
+        }
+
+        #pragma omp parallel num_threads(numThreads) reduction(|:messagesSent) reduction(+:danglingMass)
+        {
+            int thread = omp_get_thread_num();
+            double workStart = omp_get_wtime();
+
+            if (plan.schedule == DYNAMIC_SCHEDULE) {
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (size_t k = 0; k < plan.items.size(); ++k) {
+                    const WorkItem& item = plan.items[k];
+                    if (item.edgeBegin >= 0) {
+                        processPiece(item.first, item.edgeBegin, item.edgeEnd, danglingMass, messagesSent);
+                    } else {
+                        processVertices(item.first, item.last, danglingMass, messagesSent);
+                    }
+                }
+            } else {
+                // Block k goes to thread k, and every block still runs if
+                // OpenMP starts a smaller team than the plan was built for
+                #pragma omp for schedule(static, 1) nowait
+                for (int block = 0; block < numBlocks; ++block) {
+                    processVertices(plan.threadBoundaries[block], plan.threadBoundaries[block + 1], danglingMass, messagesSent);
                 }
             }
+
+            double workEnd = omp_get_wtime();
+            #pragma omp barrier
+            busyTimes[thread] += workEnd - workStart;
+            idleTimes[thread] += omp_get_wtime() - workEnd;
         }
 
         double danglingShare = DAMPING * danglingMass / n;
+        double stepResidual = 0.0;
 
-        #pragma omp parallel for
+        #pragma omp parallel for schedule(static) reduction(+:stepResidual)
         for (int v = 0; v < n; ++v) {
             nextPageRanks[v] += danglingShare;
+            stepResidual += fabs(nextPageRanks[v] - pageRanks[v]);
         }
 
-        swap(inbox, outbox);
+        inbox.swap(outbox);
         pageRanks.swap(nextPageRanks);
-        fill(nextPageRanks.begin(), nextPageRanks.end(), 0.0);
+
+        supersteps = step + 1;
+        residual = stepResidual;
+        converged = residual < epsilon;
+
+        if (checkpoints.due(supersteps)) {
+            Checkpoint& checkpoint = checkpointWriter.beginSnapshot(supersteps);
+            copyToCheckpoint(pageRanks.data(), n, checkpoint.vector(0));
+            copyToCheckpoint(inbox.data(), n, checkpoint.vector(1));
+            checkpoint.header.scalars[0] = residual;
+            checkpointWriter.commitSnapshot();
+        }
+    }
+    checkpointWriter.finish();
+
+    if (reportThreads) {
+        reportThreadTimes(plan.schedule, busyTimes, idleTimes);
+    }
+
+    return vector<Rank>(pageRanks.begin(), pageRanks.end());
+}
+
+// Same supersteps in one parallel pass over the vertices (static schedule).
+// Stored ranks leave out the dangling share, which is carried as a scalar
+// and added when a rank is read, so the previous step's residual is also
+// taken in this pass (one step late, the last one in a completion pass).
+// Pushing, the pass zeroes each inbox entry it consumes, so after the swap
+// the outbox starts empty without a separate fill.
+template <typename Rank>
+vector<Rank> rankPagesFused(const GraphView& graph, const NumaVector<double>& inverseOutDegrees, bool pullMode, bool firstTouch, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
+
+    NumaVector<Rank> baseRanks, otherBaseRanks, inbox, outbox;
+    initialize<Rank>(baseRanks, n, 1.0 / n, firstTouch);
+    initialize<Rank>(otherBaseRanks, n, 0.0, firstTouch);
+    initialize<Rank>(inbox, n, 0.0, firstTouch);
+    initialize<Rank>(outbox, n, 0.0, firstTouch);
+
+    double pendingShare = 0.0;
+    double previousShare = 0.0;
+    bool messagesSent = true;
+    bool converged = false;
+
+    supersteps = 0;
+    residual = 0.0;
+
+    for (int step = 0; step < maxSupersteps && messagesSent; ++step) {
+        double danglingMass = 0.0;
+        double previousResidual = 0.0;
+        messagesSent = false;
+
+        const Rank* base = baseRanks.data();
+        Rank* nextBase = otherBaseRanks.data();
+        Rank* received = inbox.data();
+        Rank* sending = outbox.data();
+        const double* inverseDegrees = inverseOutDegrees.data();
+        double share = pendingShare;
+        double oldShare = previousShare;
+        bool residualWanted = step > 0;
+
+        if (pullMode) {
+            #pragma omp parallel for schedule(static) reduction(|:messagesSent) reduction(+:danglingMass, previousResidual)
+            for (int v = 0; v < n; ++v) {
+                Rank rank = base[v] + share;
+                if (residualWanted) {
+                    previousResidual += fabs(rank - Rank(nextBase[v] + oldShare));
+                }
+                nextBase[v] = (1.0 - DAMPING) / n + DAMPING * double(received[v]);
+
+                if (graph.outDegree(v) == 0) {
+                    danglingMass += rank;
+                }
+
+                double gathered = 0.0;
+                for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+                    int u = graph.inEdges[i];
+                    gathered += Rank(base[u] + share) * inverseDegrees[u];
+                    messagesSent = true;
+                }
+                sending[v] = gathered;
+            }
+        } else {
+            #pragma omp parallel for schedule(static) reduction(|:messagesSent) reduction(+:danglingMass, previousResidual)
+            for (int v = 0; v < n; ++v) {
+                Rank rank = base[v] + share;
+                if (residualWanted) {
+                    previousResidual += fabs(rank - Rank(nextBase[v] + oldShare));
+                }
+                nextBase[v] = (1.0 - DAMPING) / n + DAMPING * double(received[v]);
+                received[v] = 0.0;
+
+                int start = graph.offsets[v];
+                int end = graph.offsets[v + 1];
+
+                if (start == end) {
+                    danglingMass += rank;
+                } else {
+                    double vertexShare = rank / (end - start);
+                    for (int i = start; i < end; ++i) {
+                        int u = graph.edges[i];
+                        #pragma omp atomic
+                        sending[u] += Rank(vertexShare);
+                    }
+                    messagesSent = true;
+                }
+            }
+        }
+
+        // The residual of step - 1 is now known; if it converged, the ranks
+        // of that step are still intact in baseRanks and pendingShare
+        if (step > 0) {
+            residual = previousResidual;
+            converged = residual < epsilon;
+            if (converged) {
+                break;
+            }
+        }
+
+        baseRanks.swap(otherBaseRanks);
+        inbox.swap(outbox);
+        previousShare = pendingShare;
+        pendingShare = DAMPING * danglingMass / n;
+        supersteps = step + 1;
+    }
+
+    // Completion pass: add the pending share and, unless the loop already
+    // stopped on it, take the residual of the last step
+    bool residualPending = supersteps > 0 && !converged;
+    double lastResidual = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:lastResidual)
+    for (int v = 0; v < n; ++v) {
+        Rank rank = baseRanks[v] + pendingShare;
+        if (residualPending) {
+            lastResidual += fabs(rank - Rank(otherBaseRanks[v] + previousShare));
+        }
+        baseRanks[v] = rank;
+    }
+    if (residualPending) {
+        residual = lastResidual;
+    }
+
+    return vector<Rank>(baseRanks.begin(), baseRanks.end());
+}
+
+// Gauss-Seidel supersteps: every vertex pulls over its in-edges from the
+// ranks as they stand and overwrites its own rank in place, so an update is
+// seen by every vertex processed after it in the sweep, on any thread. Ranks
+// are read and written with relaxed atomics, which never tear and take no
+// lock; a rank a thread is writing may be read old or new. The dangling mass
+// is the one of the previous sweep. With priority, each thread visits the
+// chunks of its block in decreasing order of their change in the previous
+// sweep, so the vertices still moving most publish first.
+template <typename Rank>
+vector<Rank> rankPagesAsync(const GraphView& graph, const NumaVector<double>& inverseOutDegrees, bool priority, bool firstTouch, const LoopPlan& plan, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
+
+    NumaVector<Rank> pageRanks;
+    initialize<Rank>(pageRanks, n, 1.0 / n, firstTouch);
+
+    // Chunks of at most ASYNC_CHUNK vertices within each block of the plan;
+    // block b visits chunkOrder[blockChunks[b]] .. chunkOrder[blockChunks[b + 1] - 1]
+    int numBlocks = plan.threadBoundaries.size() - 1;
+    vector<int> chunkFirsts, blockChunks(1, 0);
+    for (int block = 0; block < numBlocks; ++block) {
+        for (int v = plan.threadBoundaries[block]; v < plan.threadBoundaries[block + 1]; v += ASYNC_CHUNK) {
+            chunkFirsts.push_back(v);
+        }
+        blockChunks.push_back(chunkFirsts.size());
     }
-    
+    int numChunks = blockChunks.back();
+    vector<int> chunkOrder(numChunks);
+    vector<double> chunkResiduals(numChunks, 0.0);
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+        chunkOrder[chunk] = chunk;
+    }
+
+    double danglingMass = 0.0;
+    for (int v = 0; v < n; ++v) {
+        if (graph.outDegree(v) == 0) {
+            danglingMass += 1.0 / n;
+        }
+    }
+
+    Rank* ranks = pageRanks.data();
+    const double* inverseDegrees = inverseOutDegrees.data();
+
+    supersteps = 0;
+    residual = 0.0;
+
+    for (int step = 0; step < maxSupersteps; ++step) {
+        double base = (1.0 - DAMPING) / n + DAMPING * danglingMass / n;
+        double nextDanglingMass = 0.0;
+        double stepResidual = 0.0;
+
+        // Block b goes to thread b, and every block still runs if OpenMP
+        // starts a smaller team than the plan was built for
+        #pragma omp parallel for schedule(static, 1) num_threads(numBlocks) reduction(+:nextDanglingMass, stepResidual)
+        for (int block = 0; block < numBlocks; ++block) {
+            int* order = chunkOrder.data();
+            double* changes = chunkResiduals.data();
+
+            if (priority) {
+                stable_sort(order + blockChunks[block], order + blockChunks[block + 1], [=](int a, int b) {
+                    return changes[a] > changes[b];
+                });
+            }
+
+            for (int k = blockChunks[block]; k < blockChunks[block + 1]; ++k) {
+                int chunk = order[k];
+                int last = min(chunkFirsts[chunk] + ASYNC_CHUNK, plan.threadBoundaries[block + 1]);
+                double chunkResidual = 0.0;
+
+                for (int v = chunkFirsts[chunk]; v < last; ++v) {
+                    double gathered = 0.0;
+                    for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+                        int u = graph.inEdges[i];
+                        Rank rank;
+                        __atomic_load(&ranks[u], &rank, __ATOMIC_RELAXED);
+                        gathered += rank * inverseDegrees[u];
+                    }
+
+                    Rank oldRank;
+                    __atomic_load(&ranks[v], &oldRank, __ATOMIC_RELAXED);
+                    Rank newRank = base + DAMPING * gathered;
+                    __atomic_store(&ranks[v], &newRank, __ATOMIC_RELAXED);
+
+                    chunkResidual += fabs(double(newRank) - oldRank);
+                    if (graph.outDegree(v) == 0) {
+                        nextDanglingMass += newRank;
+                    }
+                }
+
+                changes[chunk] = chunkResidual;
+                stepResidual += chunkResidual;
+            }
+        }
+
+        danglingMass = nextDanglingMass;
+        supersteps = step + 1;
+        residual = stepResidual;
+        if (residual < epsilon) {
+            break;
+        }
+    }
+
+    return vector<Rank>(pageRanks.begin(), pageRanks.end());
+}
+
+// Delta-PageRank over an active-vertex frontier, as in the sequential
+// engine: ranks are (c + g) * z with z solved by residual pushing and the
+// dangling share g in closed form. A vertex votes to halt while its pending
+// change is at most threshold / n in rank terms. Sparse supersteps push from
+// the queue with atomic adds and collect the vertices that received in
+// per-thread lists; dense supersteps pull over in-edges against the bitmap
+// without atomics.
+template <typename Rank>
+vector<Rank> rankPagesDelta(const GraphView& graph, long long m, bool firstTouch, int maxSupersteps, double threshold, int& supersteps, double& residual) {
+    int n = graph.n;
+
+    NumaVector<Rank> settled, pending, shares;
+    NumaVector<char> touched;
+    initialize<Rank>(settled, n, 0.0, firstTouch);
+    initialize<Rank>(pending, n, 1.0, firstTouch);
+    initialize<Rank>(shares, n, 0.0, firstTouch);
+    initialize<char>(touched, n, 0, firstTouch);
+
+    Rank* pendingRanks = pending.data();
+    Rank* settledRanks = settled.data();
+    Rank* sharedRanks = shares.data();
+    char* received = touched.data();
+
+    double activeThreshold = threshold / (1.0 - DAMPING);
+    auto active = [=](int v) {
+        return pendingRanks[v] > activeThreshold;
+    };
+    auto settle = [=](int u) {
+        settledRanks[u] += pendingRanks[u];
+        int degree = graph.outDegree(u);
+        sharedRanks[u] = degree > 0 ? DAMPING * double(pendingRanks[u]) / degree : 0.0;
+        pendingRanks[u] = 0.0;
+    };
+
+    Frontier frontier, next;
+    frontier.allocate(n);
+    next.allocate(n);
+    frontier.assignBitmap(graph.offsets, active);
+    frontier.adapt(m);
+
+    long long activations = 0;
+    int denseSupersteps = 0;
+    supersteps = 0;
+
+    for (int step = 0; step < maxSupersteps && !frontier.empty(); ++step) {
+        activations += frontier.count;
+
+        if (frontier.dense) {
+            ++denseSupersteps;
+            const Frontier& current = frontier;
+
+            #pragma omp parallel for schedule(static)
+            for (int u = 0; u < n; ++u) {
+                if (current.contains(u)) {
+                    settle(u);
+                }
+            }
+
+            // Pull: every vertex gathers the shares of its active in-neighbours
+            #pragma omp parallel for schedule(static)
+            for (int v = 0; v < n; ++v) {
+                double sum = 0.0;
+                for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+                    int u = graph.inEdges[i];
+                    if (current.contains(u)) {
+                        sum += sharedRanks[u];
+                    }
+                }
+                pendingRanks[v] += sum;
+            }
+            next.assignBitmap(graph.offsets, active);
+        } else {
+            const int* queue = frontier.vertices.data();
+            int queueSize = frontier.vertices.size();
+
+            #pragma omp parallel for schedule(static)
+            for (int k = 0; k < queueSize; ++k) {
+                settle(queue[k]);
+            }
+
+            // Push from the queue; only vertices that received can wake up
+            #pragma omp parallel
+            {
+                vector<int> candidates;
+
+                #pragma omp for schedule(dynamic, 64)
+                for (int k = 0; k < queueSize; ++k) {
+                    int u = queue[k];
+                    Rank share = sharedRanks[u];
+                    for (int i = graph.offsets[u]; i < graph.offsets[u + 1]; ++i) {
+                        int v = graph.edges[i];
+                        #pragma omp atomic
+                        pendingRanks[v] += share;
+                        if (!__atomic_load_n(&received[v], __ATOMIC_RELAXED) && !__atomic_exchange_n(&received[v], 1, __ATOMIC_RELAXED)) {
+                            candidates.push_back(v);
+                        }
+                    }
+                }
+
+                // The barrier closing the push makes every pending sum final
+                vector<int> woken;
+                for (int v : candidates) {
+                    received[v] = 0;
+                    if (active(v)) {
+                        woken.push_back(v);
+                    }
+                }
+
+                #pragma omp critical
+                next.vertices.insert(next.vertices.end(), woken.begin(), woken.end());
+            }
+            next.assignQueue(graph.offsets);
+        }
+
+        next.adapt(m);
+        frontier.swap(next);
+        next.clear();
+        supersteps = step + 1;
+    }
+
+    // g = d * (c + g) * S / n, with S the settled sum of the dangling vertices
+    double danglingSettled = 0.0;
+    double pendingTotal = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:danglingSettled, pendingTotal)
+    for (int v = 0; v < n; ++v) {
+        if (graph.outDegree(v) == 0) {
+            danglingSettled += settledRanks[v];
+        }
+        pendingTotal += pendingRanks[v];
+    }
+    double teleport = (1.0 - DAMPING) / n;
+    double scale = teleport / (1.0 - DAMPING * danglingSettled / n);
+
+    vector<Rank> pageRanks(n);
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < n; ++v) {
+        pageRanks[v] = scale * settledRanks[v];
+    }
+    residual = scale * pendingTotal;
+
+    cout << "Delta mode: " << activations << " vertex updates in " << supersteps << " supersteps ("
+         << (supersteps > 0 ? 100.0 * activations / ((double)n * supersteps) : 0.0) << "% of a full sweep each), "
+         << denseSupersteps << " dense" << endl;
     return pageRanks;
 }
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS>" << endl;
+        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--epsilon <EPSILON>] [--input <GRAPH_FILE>] [--mode push|pull] [--precision double|float] [--reorder degree|rcm|gorder] [--numa] [--numa-nodes <NODES>] [--schedule vertex|edge|dynamic] [--report-threads] [--fused] [--delta <THRESHOLD>] [--async] [--priority] [--checkpoint <SUPERSTEPS>] [--checkpoint-file <PATH>] [--resume]" << endl;
         return 1;
     }
     int maxSupersteps = atoi(argv[1]);
 
-    unordered_map<string, int> pageIds;
-    vector<string> pageNames;
-    vector<vector<int>> outEdges;
-
     string inputFile = "/app/input/graph.txt";
-    loadInput(inputFile, pageIds, pageNames, outEdges);
+    double epsilon = 0.0;
+    bool pullMode = false;
+    bool singlePrecision = false;
+    VertexOrder vertexOrder = ORIGINAL_ORDER;
+    bool numaAware = false;
+    int numaNodes = 0;
+    LoopSchedule loopSchedule = VERTEX_SCHEDULE;
+    bool reportThreads = false;
+    bool fused = false;
+    bool delta = false;
+    double deltaThreshold = 0.0;
+    bool async = false;
+    bool priority = false;
+    CheckpointOptions checkpoints;
+    checkpoints.path = "/app/output/parallel.checkpoint";
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc) {
+            pullMode = string(argv[++i]) == "pull";
+        } else if (arg == "--precision" && i + 1 < argc) {
+            singlePrecision = string(argv[++i]) == "float";
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertexOrder = parseVertexOrder(argv[++i]);
+        } else if (arg == "--numa") {
+            numaAware = true;
+        } else if (arg == "--numa-nodes" && i + 1 < argc) {
+            numaAware = true;
+            numaNodes = atoi(argv[++i]);
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            loopSchedule = parseLoopSchedule(argv[++i]);
+        } else if (arg == "--report-threads") {
+            reportThreads = true;
+        } else if (arg == "--fused") {
+            fused = true;
+        } else if (arg == "--delta" && i + 1 < argc) {
+            delta = true;
+            deltaThreshold = atof(argv[++i]);
+        } else if (arg == "--async") {
+            async = true;
+        } else if (arg == "--priority") {
+            async = true;
+            priority = true;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoints.interval = max(0, atoi(argv[++i]));
+        } else if (arg == "--checkpoint-file" && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (arg == "--resume") {
+            checkpoints.resume = true;
+        }
+    }
+
+    // The asynchronous mode always pulls, in place
+    if (async && (delta || fused)) {
+        cout << "Asynchronous mode updates ranks in place, ignoring --fused and --delta" << endl;
+        delta = false;
+        fused = false;
+    }
+    if (async && loopSchedule == DYNAMIC_SCHEDULE) {
+        cout << "Asynchronous mode keeps one block per thread, ignoring --schedule dynamic" << endl;
+        loopSchedule = VERTEX_SCHEDULE;
+    }
+    if (async) {
+        pullMode = true;
+    }
+
+    // Only the BSP supersteps keep their state in checkpoints
+    if ((fused || delta || async) && (checkpoints.interval > 0 || checkpoints.resume)) {
+        cerr << "Error: checkpoints are not supported with --fused, --delta and --async, drop --checkpoint and --resume" << endl;
+        return 1;
+    }
+
+    // Delta mode picks push or pull per superstep from the frontier
+    if (delta && (pullMode || fused)) {
+        cout << "Delta mode chooses push or pull per superstep, ignoring --mode and --fused" << endl;
+        pullMode = false;
+        fused = false;
+    }
+
+    // The fused pass and delta mode always run the static schedule
+    if ((fused || delta) && loopSchedule != VERTEX_SCHEDULE) {
+        cout << (delta ? "Delta" : "Fused") << " mode uses the static vertex schedule, ignoring --schedule " << loopScheduleName(loopSchedule) << endl;
+        loopSchedule = VERTEX_SCHEDULE;
+    }
+
+    PageNames pageNames;
+    Graph graph;
+
+    auto loadStart = high_resolution_clock::now();
+    loadGraph(inputFile, pageNames, graph);
+
+    // Relabel for locality, ranks are mapped back to the original ids below
+    auto reorderStart = high_resolution_clock::now();
+    vector<int> newIds;
+    if (vertexOrder != ORIGINAL_ORDER) {
+        newIds = reorderGraph(graph, vertexOrder);
+    }
+    long long reorderTime = duration_cast<milliseconds>(high_resolution_clock::now() - reorderStart).count();
+
+    if (pullMode || delta) {
+        buildInEdges(graph);
+    }
+
+    // NUMA mode: pin the team node by node (unless OMP_PROC_BIND already
+    // binds it) and give every node its slice of the graph
+    GraphView view = viewGraph(graph);
+    PlacedGraph placedGraph;
+    if (numaAware) {
+        vector<vector<int>> nodeCpus = readNodeCpus();
+        if (numaNodes > 0 && numaNodes < (int)nodeCpus.size()) {
+            nodeCpus.resize(numaNodes);
+        }
+        if (getenv("OMP_NUM_THREADS") == nullptr) {
+            int cpus = 0;
+            for (const vector<int>& node : nodeCpus) {
+                cpus += node.size();
+            }
+            omp_set_num_threads(cpus);
+        }
+
+        if (omp_get_proc_bind() == omp_proc_bind_false) {
+            pinThreads(nodeCpus);
+        }
+        cout << "NUMA mode: " << omp_get_max_threads() << " threads on " << nodeCpus.size() << " nodes, "
+             << (omp_get_proc_bind() == omp_proc_bind_false ? "pinned node by node" : "bound by OMP_PROC_BIND") << endl;
+
+        placeGraph(graph, placedGraph);
+        view = placedGraph.view(graph.n);
+        numaNodes = nodeCpus.size();
+    }
+
+    NumaVector<double> inverseOutDegrees;
+    if (pullMode) {
+        computeInverseOutDegrees(view, inverseOutDegrees);
+    }
+
+    LoopPlan plan;
+    buildLoopPlan(loopSchedule, view.n, pullMode ? view.inOffsets : view.offsets, omp_get_max_threads(), plan);
+    auto loadEnd = high_resolution_clock::now();
+    long long loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count() - reorderTime;
+
+    int supersteps;
+    double residual;
 
     auto start = high_resolution_clock::now();
-    vector<double> pageRanks = rankPages(pageIds, pageNames, outEdges, maxSupersteps);
+    vector<double> pageRanks;
+    if (singlePrecision) {
+        vector<float> singlePageRanks = async ? rankPagesAsync<float>(view, inverseOutDegrees, priority, numaAware, plan, maxSupersteps, epsilon, supersteps, residual)
+                                      : delta ? rankPagesDelta<float>(view, graph.m, numaAware, maxSupersteps, deltaThreshold, supersteps, residual)
+                                      : fused ? rankPagesFused<float>(view, inverseOutDegrees, pullMode, numaAware, maxSupersteps, epsilon, supersteps, residual)
+                                              : rankPages<float>(view, inverseOutDegrees, pullMode, numaAware, plan, reportThreads, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+        pageRanks.assign(singlePageRanks.begin(), singlePageRanks.end());
+    } else {
+        pageRanks = async ? rankPagesAsync<double>(view, inverseOutDegrees, priority, numaAware, plan, maxSupersteps, epsilon, supersteps, residual)
+                  : delta ? rankPagesDelta<double>(view, graph.m, numaAware, maxSupersteps, deltaThreshold, supersteps, residual)
+                  : fused ? rankPagesFused<double>(view, inverseOutDegrees, pullMode, numaAware, maxSupersteps, epsilon, supersteps, residual)
+                          : rankPages<double>(view, inverseOutDegrees, pullMode, numaAware, plan, reportThreads, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+    }
     auto end = high_resolution_clock::now();
     long long executionTime =duration_cast<milliseconds>(end - start).count();
 
-    string outputFile = "/app/output/parallel_" + to_string(maxSupersteps) + ".txt";
-    generateOutput(outputFile, pageRanks, pageNames, executionTime);
+    if (vertexOrder != ORIGINAL_ORDER) {
+        auto restoreStart = high_resolution_clock::now();
+        pageRanks = restoreOrder(pageRanks, newIds);
+        reorderTime += duration_cast<milliseconds>(high_resolution_clock::now() - restoreStart).count();
+        cout << "Reordered vertices (" << vertexOrderName(vertexOrder) << ") in " << reorderTime << " ms" << endl;
+    }
+
+    string outputFile = "/app/output/parallel_" + string(async ? (priority ? "async_priority_" : "async_") : pullMode ? "pull_" : "") + (numaAware ? "numa" + to_string(numaNodes) + "_" : string()) + (loopSchedule != VERTEX_SCHEDULE ? string(loopScheduleName(loopSchedule)) + "_" : string()) + string(delta ? "delta_" : fused ? "fused_" : "") + string(singlePrecision ? "float_" : "") + (vertexOrder != ORIGINAL_ORDER ? string(vertexOrderName(vertexOrder)) + "_" : string()) + to_string(maxSupersteps) + ".txt";
+    generateOutput(outputFile, pageRanks, pageNames, executionTime, supersteps, residual, loadTime, reorderTime);
 
     return 0;
 }
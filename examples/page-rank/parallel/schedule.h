@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// How the vertex loop of a superstep is split among threads: one block of
+// equal vertex count per thread, one block of equal vertex + edge count per
+// thread, or small edge-balanced tasks handed out dynamically with
+// high-degree vertices split across several tasks
+enum LoopSchedule {
+    VERTEX_SCHEDULE,
+    EDGE_SCHEDULE,
+    DYNAMIC_SCHEDULE
+};
+
+// Tasks per thread the dynamic schedule aims for, and the smallest task
+const int TASKS_PER_THREAD = 16;
+const int MIN_TASK_EDGES = 256;
+
+inline LoopSchedule parseLoopSchedule(const std::string& name) {
+    if (name == "edge") {
+        return EDGE_SCHEDULE;
+    } else if (name == "dynamic") {
+        return DYNAMIC_SCHEDULE;
+    }
+    return VERTEX_SCHEDULE;
+}
+
+inline const char* loopScheduleName(LoopSchedule schedule) {
+    switch (schedule) {
+        case EDGE_SCHEDULE: return "edge";
+        case DYNAMIC_SCHEDULE: return "dynamic";
+        default: return "vertex";
+    }
+}
+
+// Task of the dynamic schedule: vertices first .. last - 1 with all their
+// edges, or, when edgeBegin >= 0, the edges edgeBegin .. edgeEnd - 1 of the
+// single split vertex first
+struct WorkItem {
+    int first;
+    int last;
+    int edgeBegin;
+    int edgeEnd;
+};
+
+struct LoopPlan {
+    LoopSchedule schedule = VERTEX_SCHEDULE;
+    std::vector<int> threadBoundaries;
+    std::vector<WorkItem> items;
+    std::vector<int> splitVertices;
+};
+
+// Builds the plan over the rows the loop traverses (out-edges when pushing,
+// in-edges when pulling). A vertex weighs 1 + its degree, so rowOffsets[v] + v
+// is the weight before v.
+inline void buildLoopPlan(LoopSchedule schedule, int n, const int* rowOffsets, int threads, LoopPlan& plan) {
+    plan = LoopPlan();
+    plan.schedule = schedule;
+    long long total = (long long)n + rowOffsets[n];
+
+    if (schedule == VERTEX_SCHEDULE) {
+        plan.threadBoundaries.assign(threads + 1, n);
+        for (int thread = 0; thread < threads; ++thread) {
+            plan.threadBoundaries[thread] = (long long)n * thread / threads;
+        }
+        return;
+    }
+
+    if (schedule == EDGE_SCHEDULE) {
+        plan.threadBoundaries.assign(threads + 1, n);
+        int v = 0;
+        for (int thread = 0; thread < threads; ++thread) {
+            long long target = total * thread / threads;
+            while (v < n && (long long)rowOffsets[v] + v < target) {
+                ++v;
+            }
+            plan.threadBoundaries[thread] = v;
+        }
+        return;
+    }
+
+    if (schedule == DYNAMIC_SCHEDULE) {
+        long long taskWeight = std::max<long long>(MIN_TASK_EDGES, total / ((long long)threads * TASKS_PER_THREAD));
+        int first = 0;
+        long long weight = 0;
+        for (int v = 0; v < n; ++v) {
+            int degree = rowOffsets[v + 1] - rowOffsets[v];
+            if (degree > taskWeight) {
+                if (first < v) {
+                    plan.items.push_back({first, v, -1, -1});
+                }
+                for (int begin = rowOffsets[v]; begin < rowOffsets[v + 1]; begin += taskWeight) {
+                    plan.items.push_back({v, v + 1, begin, (int)std::min<long long>(begin + taskWeight, rowOffsets[v + 1])});
+                }
+                plan.splitVertices.push_back(v);
+                first = v + 1;
+                weight = 0;
+                continue;
+            }
+
+            weight += 1 + degree;
+            if (weight >= taskWeight) {
+                plan.items.push_back({first, v + 1, -1, -1});
+                first = v + 1;
+                weight = 0;
+            }
+        }
+        if (first < n) {
+            plan.items.push_back({first, n, -1, -1});
+        }
+    }
+}
+
+// Busy time is spent in the vertex loop, idle time waiting for the slowest
+// thread at the barrier closing it
+inline void reportThreadTimes(LoopSchedule schedule, const std::vector<double>& busyTimes, const std::vector<double>& idleTimes) {
+    double maxBusy = 0.0;
+    double totalBusy = 0.0;
+    for (double busy : busyTimes) {
+        maxBusy = std::max(maxBusy, busy);
+        totalBusy += busy;
+    }
+    double meanBusy = totalBusy / busyTimes.size();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Vertex loop, " << loopScheduleName(schedule) << " schedule:" << std::endl;
+    for (size_t thread = 0; thread < busyTimes.size(); ++thread) {
+        std::cout << "  thread " << thread << ": busy " << busyTimes[thread] * 1000.0 << " ms, idle " << idleTimes[thread] * 1000.0 << " ms" << std::endl;
+    }
+    std::cout << std::setprecision(2) << "  imbalance (max / mean busy): " << (meanBusy > 0.0 ? maxBusy / meanBusy : 1.0) << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,175 @@
+#include <mpi.h>
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "../distributed/partition.h"
+#include "pregel.h"
+#include "pregel_mpi.h"
+#include "programs.h"
+
+using namespace std;
+using namespace std::chrono;
+
+template <typename Value>
+void generateOutput(const string& filename, const vector<Value>& values, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime) {
+    ofstream outFile(filename);
+
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << endl;
+    for (size_t i = 0; i < values.size(); ++i) {
+        outFile << pageNames[i] << " " << values[i] << endl;
+    }
+
+    outFile.close();
+}
+
+// Runs program on the chosen backend and writes the values from rank 0
+template <typename Program>
+void runProgram(const Program& program, Graph& graph, const PageNames& pageNames, const string& binaryInputFile, PartitionStrategy strategy, const string& backend, const string& algorithm, int maxSupersteps, long long loadTime) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // The MPI backend gathers the in-edges of every rank's own vertices
+    if (Program::IN_EDGES && backend != "mpi") {
+        buildInEdges(graph);
+    }
+
+    vector<typename Program::Value> values;
+    PregelStats stats;
+
+    auto start = high_resolution_clock::now();
+    if (backend == "mpi") {
+        stats = runDistributed(program, graph, binaryInputFile, strategy, maxSupersteps, values);
+    } else if (backend == "openmp") {
+        stats = runParallel(program, graph, maxSupersteps, values);
+    } else {
+        stats = runSequential(program, graph, maxSupersteps, values);
+    }
+    auto end = high_resolution_clock::now();
+    long long executionTime = duration_cast<milliseconds>(end - start).count();
+
+    if (rank == 0) {
+        double residual = stats.aggregated.empty() ? 0.0 : stats.aggregated[0];
+        string outputFile = "/app/output/pregel_" + backend + "_" + algorithm + "_" + to_string(maxSupersteps) + ".txt";
+        generateOutput(outputFile, values, pageNames, executionTime, stats.supersteps, residual, loadTime);
+    }
+}
+
+int main(int argc, char** argv) {
+    int threadSupport;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &threadSupport);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc < 2) {
+        if (rank == 0) {
+            cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--algorithm pagerank|components|sssp] [--backend sequential|openmp|mpi] [--epsilon <EPSILON>] [--source <PAGE>] [--input <GRAPH_FILE>] [--partition vertex|edge|hash|ldg] [--threads <THREADS_PER_PROCESS>]" << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    int maxSupersteps = atoi(argv[1]);
+
+    string inputFile = "/app/input/graph.txt";
+    string algorithm = "pagerank";
+    string backend = "sequential";
+    string source;
+    double epsilon = 0.0;
+    PartitionStrategy strategy = VERTEX_RANGES;
+    string checkpointFlag;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithm = argv[++i];
+        } else if (arg == "--backend" && i + 1 < argc) {
+            backend = argv[++i];
+        } else if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--source" && i + 1 < argc) {
+            source = argv[++i];
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--partition" && i + 1 < argc) {
+            strategy = parsePartitionStrategy(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            omp_set_num_threads(max(1, atoi(argv[++i])));
+        } else if (arg == "--checkpoint" || arg == "--checkpoint-file" || arg == "--resume") {
+            checkpointFlag = arg;
+        }
+    }
+
+    // Only the hand-written engines write checkpoints
+    if (!checkpointFlag.empty()) {
+        if (rank == 0) {
+            cerr << "Error: the Pregel runtime does not support checkpoints, drop " << checkpointFlag << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (backend != "mpi" && size > 1) {
+        if (rank == 0) {
+            cerr << "The " << backend << " backend runs in a single process, use --backend mpi with mpiexec" << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (threadSupport < MPI_THREAD_FUNNELED && omp_get_max_threads() > 1) {
+        if (rank == 0) {
+            cerr << "Warning: MPI does not support MPI_THREAD_FUNNELED, running with 1 thread per process" << endl;
+        }
+        omp_set_num_threads(1);
+    }
+
+    PageNames pageNames;
+    Graph graph;
+    string binaryInputFile = isBinaryGraph(inputFile) ? inputFile : "";
+
+    // As in the distributed engine, only rank 0 loads the whole graph (with
+    // a binary graph only a mapping); the MPI backend hands every rank its
+    // own vertices
+    long long loadTime = 0;
+    if (rank == 0) {
+        auto loadStart = high_resolution_clock::now();
+        loadGraph(inputFile, pageNames, graph);
+        auto loadEnd = high_resolution_clock::now();
+        loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count();
+    }
+
+    if (algorithm == "components") {
+        runProgram(ConnectedComponentsProgram(), graph, pageNames, binaryInputFile, strategy, backend, algorithm, maxSupersteps, loadTime);
+    } else if (algorithm == "sssp") {
+        ShortestPathsProgram program;
+        program.source = source.empty() ? 0 : -1;
+        for (size_t v = 0; v < pageNames.size() && program.source < 0; ++v) {
+            if (pageNames[v] == source) {
+                program.source = v;
+            }
+        }
+        MPI_Bcast(&program.source, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (program.source < 0) {
+            if (rank == 0) {
+                cerr << "Source page " << source << " is not in the graph" << endl;
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        runProgram(program, graph, pageNames, binaryInputFile, strategy, backend, algorithm, maxSupersteps, loadTime);
+    } else {
+        PageRankProgram program;
+        program.epsilon = epsilon;
+        runProgram(program, graph, pageNames, binaryInputFile, strategy, backend, "pagerank", maxSupersteps, loadTime);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <omp.h>
+
+#include <array>
+#include <vector>
+
+#include "../common/combiner.h"
+#include "../common/graph.h"
+#include "../common/message_store.h"
+
+// Vertex-centric (Pregel) runtime. A vertex program is a type with
+//   using Value, Message, Combiner;        // Combiner as in combiner.h
+//   static const int AGGREGATORS;          // double sum aggregators, >= 1
+//   static const bool IN_EDGES;            // needs graph.inEdges
+//   static const bool VOTES_TO_HALT;       // may call voteToHalt
+//   void initialize(Context&, int v, Value& value) const;
+//   void compute(Context&, int v, Value& value, ArrayRange<Message> messages) const;
+//   bool halt(const double* aggregated) const;
+// initialize runs as superstep 0 and may already send and aggregate; every
+// later superstep calls compute on the vertices that are active or have a
+// message. Messages to a vertex are always combined, so compute sees at most
+// one. A program that never votes to halt runs every vertex in every
+// superstep and always gets one message, the combiner's identity if none was
+// sent; the backends then keep no received flags or halted states. The run
+// ends after maxSupersteps, when every vertex has voted to halt and no
+// message is in flight, or when halt returns true on the aggregates of the
+// superstep just finished. By convention aggregator 0 holds the program's
+// residual, which the engine reports.
+//
+// Backends are templates over the program, so compute and the context calls
+// inline into the vertex loop as in a hand-written engine, and the traits
+// above drop the bookkeeping a program does not need at compile time.
+
+template <typename T>
+struct ArrayRange {
+    const T* first;
+    const T* last;
+
+    const T* begin() const {
+        return first;
+    }
+
+    const T* end() const {
+        return last;
+    }
+
+    bool empty() const {
+        return first == last;
+    }
+
+    int size() const {
+        return last - first;
+    }
+};
+
+struct PregelStats {
+    int supersteps = 0;
+    std::vector<double> aggregated;
+};
+
+// Everything a vertex program sees of the superstep. Sending goes through
+// Derived::sendToAll, which each backend implements with the store pointers
+// in locals: the char stores of the received flags would otherwise make the
+// compiler reload them for every message.
+template <typename Program, typename Derived>
+struct ContextBase {
+    using Message = typename Program::Message;
+
+    const Graph* graph = nullptr;
+    int n = 0;
+    const double* globalAggregates = nullptr;
+    std::array<double, Program::AGGREGATORS> aggregates;
+    int step = 0;
+    int vertex = 0;
+    bool halting = false;
+    bool sent = false;
+    long long active = 0;
+
+    int superstep() const {
+        return step;
+    }
+
+    int vertexCount() const {
+        return n;
+    }
+
+    int outDegree() const {
+        return graph->outDegree(vertex);
+    }
+
+    ArrayRange<int> outNeighbours() const {
+        return {graph->edges + graph->offsets[vertex], graph->edges + graph->offsets[vertex + 1]};
+    }
+
+    ArrayRange<int> inNeighbours() const {
+        return {graph->inEdges.data() + graph->inOffsets[vertex], graph->inEdges.data() + graph->inOffsets[vertex + 1]};
+    }
+
+    void sendMessage(int target, Message message) {
+        static_cast<Derived*>(this)->sendToAll(ArrayRange<int>{&target, &target + 1}, message);
+    }
+
+    void sendToOutNeighbours(Message message) {
+        static_cast<Derived*>(this)->sendToAll(outNeighbours(), message);
+    }
+
+    void sendToInNeighbours(Message message) {
+        static_cast<Derived*>(this)->sendToAll(inNeighbours(), message);
+    }
+
+    void voteToHalt() {
+        static_assert(Program::VOTES_TO_HALT, "the program must set VOTES_TO_HALT to vote to halt");
+        halting = true;
+    }
+
+    void aggregate(int aggregator, double value) {
+        aggregates[aggregator] += value;
+    }
+
+    // Value of an aggregator over the previous superstep
+    double aggregated(int aggregator) const {
+        return globalAggregates[aggregator];
+    }
+
+    void beginSuperstep(int superstep, const double* previousAggregates) {
+        step = superstep;
+        globalAggregates = previousAggregates;
+        aggregates.fill(0.0);
+        sent = false;
+        active = 0;
+    }
+
+    // Calls initialize or compute on vertex v, stored in row row of graph,
+    // and returns whether it voted to halt
+    template <typename Value>
+    bool run(const Program& program, int row, int v, Value& value, ArrayRange<Message> messages) {
+        vertex = row;
+        halting = false;
+        if (step == 0) {
+            program.initialize(static_cast<Derived&>(*this), v, value);
+        } else {
+            program.compute(static_cast<Derived&>(*this), v, value, messages);
+        }
+        active += !halting;
+        return halting;
+    }
+};
+
+// Combined message of row of store, always present for a program that never
+// votes to halt
+template <typename Program, typename Store>
+inline ArrayRange<typename Program::Message> messagesOf(const Store& store, int row) {
+    return {store.begin(row), Program::VOTES_TO_HALT ? store.end(row) : store.begin(row) + 1};
+}
+
+// Clears the combined messages, and the received flags if the program reads
+// them
+template <typename Program, typename Store>
+inline void clearMessages(Store& store, int row) {
+    store.values[row] = Program::Combiner::identity();
+    if (Program::VOTES_TO_HALT) {
+        store.received[row] = 0;
+    }
+}
+
+template <typename Program>
+struct SequentialContext : ContextBase<Program, SequentialContext<Program>> {
+    using Message = typename Program::Message;
+
+    CombinedMessageStore<Message, typename Program::Combiner>* outbox = nullptr;
+
+    void sendToAll(ArrayRange<int> targets, Message message) {
+        Message* values = outbox->values.data();
+        char* received = outbox->received.data();
+        for (int target : targets) {
+            values[target] = Program::Combiner::combine(values[target], message);
+            if (Program::VOTES_TO_HALT) {
+                received[target] = 1;
+            }
+        }
+        this->sent = this->sent || !targets.empty();
+    }
+};
+
+template <typename Program>
+PregelStats runSequential(const Program& program, const Graph& graph, int maxSupersteps, std::vector<typename Program::Value>& values) {
+    using Message = typename Program::Message;
+    int n = graph.n;
+
+    CombinedMessageStore<Message, typename Program::Combiner> inbox, outbox;
+    inbox.allocate(graph);
+    outbox.allocate(graph);
+    values.assign(n, typename Program::Value());
+    std::vector<char> halted(n, 0);
+
+    std::vector<double> aggregated(Program::AGGREGATORS, 0.0);
+    SequentialContext<Program> context;
+    context.graph = &graph;
+    context.n = n;
+    context.outbox = &outbox;
+
+    PregelStats stats;
+    for (int step = 0; step <= maxSupersteps; ++step) {
+        context.beginSuperstep(step, aggregated.data());
+        for (int v = 0; v < n; ++v) {
+            if (step == 0 || !Program::VOTES_TO_HALT || !halted[v] || inbox.received[v]) {
+                bool halting = context.run(program, v, v, values[v], messagesOf<Program>(inbox, v));
+                if (Program::VOTES_TO_HALT) {
+                    halted[v] = halting;
+                }
+            }
+        }
+
+        aggregated.assign(context.aggregates.begin(), context.aggregates.end());
+        inbox.swap(outbox);
+        for (int v = 0; v < n; ++v) {
+            clearMessages<Program>(outbox, v);
+        }
+
+        if (step > 0) {
+            stats.supersteps = step;
+            stats.aggregated = aggregated;
+            if (program.halt(aggregated.data())) {
+                break;
+            }
+        }
+        if (context.active == 0 && !context.sent) {
+            break;
+        }
+    }
+    return stats;
+}
+
+// Folds message into *slot with Combiner, for slots several threads send to
+template <typename Combiner, typename T>
+inline void atomicCombine(Combiner, T* slot, T message) {
+    T expected;
+    __atomic_load(slot, &expected, __ATOMIC_RELAXED);
+    T desired = Combiner::combine(expected, message);
+    while (!(desired == expected) && !__atomic_compare_exchange(slot, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        desired = Combiner::combine(expected, message);
+    }
+}
+
+// Sums take OpenMP's atomic update, as the hand-written engines do
+template <typename T>
+inline void atomicCombine(SumCombiner<T>, T* slot, T message) {
+    #pragma omp atomic
+    *slot += message;
+}
+
+template <typename Program>
+struct ParallelContext : ContextBase<Program, ParallelContext<Program>> {
+    using Message = typename Program::Message;
+
+    CombinedMessageStore<Message, typename Program::Combiner>* outbox = nullptr;
+
+    void sendToAll(ArrayRange<int> targets, Message message) {
+        Message* values = outbox->values.data();
+        char* received = outbox->received.data();
+        for (int target : targets) {
+            atomicCombine(typename Program::Combiner(), &values[target], message);
+            if (Program::VOTES_TO_HALT && !received[target]) {
+                __atomic_store_n(&received[target], 1, __ATOMIC_RELAXED);
+            }
+        }
+        this->sent = this->sent || !targets.empty();
+    }
+};
+
+// OpenMP backend: the vertex loop runs with the static schedule, every thread
+// aggregates into its own context and messages are combined atomically
+template <typename Program>
+PregelStats runParallel(const Program& program, const Graph& graph, int maxSupersteps, std::vector<typename Program::Value>& values) {
+    using Message = typename Program::Message;
+    using Combiner = typename Program::Combiner;
+    int n = graph.n;
+
+    CombinedMessageStore<Message, Combiner> inbox, outbox;
+    inbox.allocate(graph);
+    outbox.allocate(graph);
+    values.assign(n, typename Program::Value());
+    std::vector<char> halted(n, 0);
+
+    std::vector<double> aggregated(Program::AGGREGATORS, 0.0);
+    std::vector<ParallelContext<Program>> contexts(omp_get_max_threads());
+    for (ParallelContext<Program>& context : contexts) {
+        context.graph = &graph;
+        context.n = n;
+    }
+
+    PregelStats stats;
+    for (int step = 0; step <= maxSupersteps; ++step) {
+        for (ParallelContext<Program>& context : contexts) {
+            context.outbox = &outbox;
+            context.beginSuperstep(step, aggregated.data());
+        }
+
+        #pragma omp parallel num_threads(contexts.size())
+        {
+            ParallelContext<Program>& context = contexts[omp_get_thread_num()];
+
+            #pragma omp for schedule(static)
+            for (int v = 0; v < n; ++v) {
+                if (step == 0 || !Program::VOTES_TO_HALT || !halted[v] || inbox.received[v]) {
+                    bool halting = context.run(program, v, v, values[v], messagesOf<Program>(inbox, v));
+                    if (Program::VOTES_TO_HALT) {
+                        halted[v] = halting;
+                    }
+                }
+            }
+        }
+
+        long long active = 0;
+        bool sent = false;
+        aggregated.assign(Program::AGGREGATORS, 0.0);
+        for (const ParallelContext<Program>& context : contexts) {
+            for (int i = 0; i < Program::AGGREGATORS; ++i) {
+                aggregated[i] += context.aggregates[i];
+            }
+            active += context.active;
+            sent = sent || context.sent;
+        }
+
+        inbox.swap(outbox);
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < n; ++v) {
+            clearMessages<Program>(outbox, v);
+        }
+
+        if (step > 0) {
+            stats.supersteps = step;
+            stats.aggregated = aggregated;
+            if (program.halt(aggregated.data())) {
+                break;
+            }
+        }
+        if (active == 0 && !sent) {
+            break;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <mpi.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../distributed/partition.h"
+#include "../distributed/routes.h"
+#include "pregel.h"
+
+template <typename T>
+inline MPI_Datatype mpiType() {
+    if (std::is_same<T, float>::value) {
+        return MPI_FLOAT;
+    } else if (std::is_same<T, int>::value) {
+        return MPI_INT;
+    } else if (std::is_same<T, long long>::value) {
+        return MPI_LONG_LONG;
+    }
+    return MPI_DOUBLE;
+}
+
+// What the local vertices send to all their neighbours on one side of their
+// edges in a superstep: one combined share per vertex (the identity if it
+// sent nothing) and, for programs that vote to halt, whether it sent. The
+// shares travel along MessageRoutes: gathered into send slots and local
+// inboxes, exchanged with MPI_Ialltoallv and folded in on arrival.
+template <typename Program>
+struct NeighbourMessages {
+    using Message = typename Program::Message;
+    using Combiner = typename Program::Combiner;
+
+    MessageRoutes routes;
+    std::vector<Message> shares;
+    std::vector<char> sent;
+    std::vector<Message> sendBuffer;
+    std::vector<Message> recvBuffer;
+    std::vector<char> sendFlags;
+    std::vector<char> recvFlags;
+
+    void allocate(int localN) {
+        shares.assign(localN, Combiner::identity());
+        sendBuffer.assign(routes.slotCount(), Combiner::identity());
+        recvBuffer.assign(routes.recvTargets.size(), Combiner::identity());
+        if (Program::VOTES_TO_HALT) {
+            sent.assign(localN, 0);
+            sendFlags.assign(sendBuffer.size(), 0);
+            recvFlags.assign(recvBuffer.size(), 0);
+        }
+    }
+
+    void reset(int i) {
+        shares[i] = Combiner::identity();
+        if (Program::VOTES_TO_HALT) {
+            sent[i] = 0;
+        }
+    }
+
+    void share(int i, Message message) {
+        shares[i] = Combiner::combine(shares[i], message);
+        if (Program::VOTES_TO_HALT) {
+            sent[i] = 1;
+        }
+    }
+
+    void fillSendSlots() {
+        int slotCount = sendBuffer.size();
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int slot = 0; slot < slotCount; ++slot) {
+            Message combined = Combiner::identity();
+            char any = 0;
+            for (int k = routes.slotOffsets[slot]; k < routes.slotOffsets[slot + 1]; ++k) {
+                int source = routes.slotSources[k];
+                combined = Combiner::combine(combined, shares[source]);
+                if (Program::VOTES_TO_HALT) {
+                    any |= sent[source];
+                }
+            }
+            sendBuffer[slot] = combined;
+            if (Program::VOTES_TO_HALT) {
+                sendFlags[slot] = any;
+            }
+        }
+    }
+
+    // Starts the exchange, adding its requests to requests
+    void startExchange(std::vector<MPI_Request>& requests) {
+        requests.emplace_back();
+        MPI_Ialltoallv(sendBuffer.data(), routes.sendCounts.data(), routes.sendDisplacements.data(), mpiType<Message>(),
+                       recvBuffer.data(), routes.recvCounts.data(), routes.recvDisplacements.data(), mpiType<Message>(), MPI_COMM_WORLD, &requests.back());
+        if (Program::VOTES_TO_HALT) {
+            requests.emplace_back();
+            MPI_Ialltoallv(sendFlags.data(), routes.sendCounts.data(), routes.sendDisplacements.data(), MPI_CHAR,
+                           recvFlags.data(), routes.recvCounts.data(), routes.recvDisplacements.data(), MPI_CHAR, MPI_COMM_WORLD, &requests.back());
+        }
+    }
+
+    // Messages of local senders to local vertex i; first starts its inbox
+    // entry rather than adding to it
+    template <typename Store>
+    void combineLocal(Store& inbox, int i, bool first) const {
+        Message combined = first ? Combiner::identity() : inbox.values[i];
+        char any = 0;
+        for (int k = routes.localOffsets[i]; k < routes.localOffsets[i + 1]; ++k) {
+            int source = routes.localSources[k];
+            combined = Combiner::combine(combined, shares[source]);
+            if (Program::VOTES_TO_HALT) {
+                any |= sent[source];
+            }
+        }
+        inbox.values[i] = combined;
+        if (Program::VOTES_TO_HALT) {
+            inbox.received[i] = first ? any : inbox.received[i] | any;
+        }
+    }
+
+    // Messages of remote senders to local vertex i, once the exchange is done
+    template <typename Store>
+    void combineReceived(Store& inbox, int i) const {
+        Message combined = inbox.values[i];
+        char any = 0;
+        for (int k = routes.recvOffsets[i]; k < routes.recvOffsets[i + 1]; ++k) {
+            int slot = routes.recvSlots[k];
+            combined = Combiner::combine(combined, recvBuffer[slot]);
+            if (Program::VOTES_TO_HALT) {
+                any |= recvFlags[slot];
+            }
+        }
+        inbox.values[i] = combined;
+        if (Program::VOTES_TO_HALT) {
+            inbox.received[i] |= any;
+        }
+    }
+};
+
+// Vertex rows are local indices, neighbours and the vertex ids the program
+// sees are global. Sends to all out- or in-neighbours become the vertex's
+// share on that side; a message to a single vertex is combined atomically
+// into directInbox if it is local, and queued for the owner otherwise.
+template <typename Program>
+struct DistributedContext : ContextBase<Program, DistributedContext<Program>> {
+    using Message = typename Program::Message;
+
+    const Partition* partition = nullptr;
+    int rank = 0;
+    NeighbourMessages<Program>* outMessages = nullptr;
+    NeighbourMessages<Program>* inMessages = nullptr;
+    CombinedMessageStore<Message, typename Program::Combiner>* directInbox = nullptr;
+    bool sentDirect = false;
+    std::vector<int> remoteTargets;
+    std::vector<Message> remoteMessages;
+
+    void sendToAll(ArrayRange<int> targets, Message message) {
+        for (int target : targets) {
+            if (partition->owner(target) == rank) {
+                int row = partition->localIndex(target);
+                atomicCombine(typename Program::Combiner(), &directInbox->values[row], message);
+                if (!directInbox->received[row]) {
+                    __atomic_store_n(&directInbox->received[row], 1, __ATOMIC_RELAXED);
+                }
+                sentDirect = true;
+            } else {
+                remoteTargets.push_back(target);
+                remoteMessages.push_back(message);
+            }
+        }
+        this->sent = this->sent || !targets.empty();
+    }
+
+    void sendToOutNeighbours(Message message) {
+        if (this->outDegree() > 0) {
+            outMessages->share(this->vertex, message);
+            this->sent = true;
+        }
+    }
+
+    void sendToInNeighbours(Message message) {
+        static_assert(Program::IN_EDGES, "the program must set IN_EDGES to send to in-neighbours");
+        if (!this->inNeighbours().empty()) {
+            inMessages->share(this->vertex, message);
+            this->sent = true;
+        }
+    }
+};
+
+// Sends the queued single-vertex messages of all contexts to their owners
+// and folds them into the next inbox
+template <typename Program>
+void exchangeDirectMessages(std::vector<DistributedContext<Program>>& contexts, const Partition& partition, int size, CombinedMessageStore<typename Program::Message, typename Program::Combiner>& nextInbox) {
+    using Message = typename Program::Message;
+
+    std::vector<int> sendCounts(size, 0), sendDisplacements(size, 0), recvCounts(size), recvDisplacements(size, 0);
+    for (const DistributedContext<Program>& context : contexts) {
+        for (int target : context.remoteTargets) {
+            sendCounts[partition.owner(target)]++;
+        }
+    }
+    for (int process = 1; process < size; ++process) {
+        sendDisplacements[process] = sendDisplacements[process - 1] + sendCounts[process - 1];
+    }
+
+    int sendTotal = sendDisplacements[size - 1] + sendCounts[size - 1];
+    std::vector<int> sendTargets(sendTotal);
+    std::vector<Message> sendMessages(sendTotal);
+    std::vector<int> position(sendDisplacements);
+    for (DistributedContext<Program>& context : contexts) {
+        for (size_t k = 0; k < context.remoteTargets.size(); ++k) {
+            int slot = position[partition.owner(context.remoteTargets[k])]++;
+            sendTargets[slot] = context.remoteTargets[k];
+            sendMessages[slot] = context.remoteMessages[k];
+        }
+        context.remoteTargets.clear();
+        context.remoteMessages.clear();
+    }
+
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int process = 1; process < size; ++process) {
+        recvDisplacements[process] = recvDisplacements[process - 1] + recvCounts[process - 1];
+    }
+    int recvTotal = recvDisplacements[size - 1] + recvCounts[size - 1];
+    std::vector<int> recvTargets(recvTotal);
+    std::vector<Message> recvMessages(recvTotal);
+    MPI_Alltoallv(sendTargets.data(), sendCounts.data(), sendDisplacements.data(), MPI_INT,
+                  recvTargets.data(), recvCounts.data(), recvDisplacements.data(), MPI_INT, MPI_COMM_WORLD);
+    MPI_Alltoallv(sendMessages.data(), sendCounts.data(), sendDisplacements.data(), mpiType<Message>(),
+                  recvMessages.data(), recvCounts.data(), recvDisplacements.data(), mpiType<Message>(), MPI_COMM_WORLD);
+
+    for (int k = 0; k < recvTotal; ++k) {
+        nextInbox.send(partition.localIndex(recvTargets[k]), recvMessages[k]);
+    }
+}
+
+// MPI backend, hybrid with OpenMP threads in every rank as the distributed
+// engine: the same partitions, CSR slices and message routes, so a rank
+// holds only its vertices, their edges and its cut. Shares are exchanged
+// while the local ones are combined into the next inbox; aggregates, the
+// active count, the sent flag and the number of queued single-vertex
+// messages travel in one MPI_Iallreduce alongside. The received shares are
+// folded into a vertex's inbox entry just before it computes, so a superstep
+// makes as many passes over the vertices as the distributed engine's. graph
+// is only read on rank 0 (see distributeGraph); values is filled on rank 0
+// only, in vertex id order.
+template <typename Program>
+PregelStats runDistributed(const Program& program, Graph& graph, const std::string& binaryInputFile, PartitionStrategy strategy, int maxSupersteps, std::vector<typename Program::Value>& values) {
+    using Message = typename Program::Message;
+    using Value = typename Program::Value;
+    const int TOTALS = Program::AGGREGATORS + 3;
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int n = rank == 0 ? graph.n : 0;
+    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    Partition partition;
+    buildPartition(graph, strategy, n, rank, size, partition);
+    int localN = partition.vertexCounts[rank];
+    std::vector<int> localVertices = partition.localVertices(rank, n);
+
+    Graph localGraph;
+    distributeGraph(graph, partition, binaryInputFile, n, rank, size, localGraph);
+
+    NeighbourMessages<Program> outMessages, inMessages;
+    buildMessageRoutes(localN, localGraph.offsets, localGraph.edges, partition, rank, size, outMessages.routes);
+    outMessages.allocate(localN);
+    if (Program::IN_EDGES) {
+        distributeInEdges(localGraph, partition, n, rank, size);
+        buildMessageRoutes(localN, localGraph.inOffsets.data(), localGraph.inEdges.data(), partition, rank, size, inMessages.routes);
+        inMessages.allocate(localN);
+    }
+    reportPartition(partition, localGraph, outMessages.routes, rank, size);
+
+    CombinedMessageStore<Message, typename Program::Combiner> inbox, nextInbox, directInbox;
+    inbox.allocate(localGraph);
+    nextInbox.allocate(localGraph);
+    directInbox.allocate(localGraph);
+    std::vector<Value> localValues(localN, Value());
+    std::vector<char> halted(Program::VOTES_TO_HALT ? localN : 0, 0);
+
+    std::vector<double> aggregated(Program::AGGREGATORS, 0.0);
+    std::vector<double> localTotals(TOTALS), totals(TOTALS);
+    std::vector<MPI_Request> requests;
+
+    std::vector<DistributedContext<Program>> contexts(omp_get_max_threads());
+    for (DistributedContext<Program>& context : contexts) {
+        context.graph = &localGraph;
+        context.n = n;
+        context.partition = &partition;
+        context.rank = rank;
+        context.outMessages = &outMessages;
+        context.inMessages = &inMessages;
+        context.directInbox = &directInbox;
+    }
+
+    PregelStats stats;
+    for (int step = 0; step <= maxSupersteps; ++step) {
+        for (DistributedContext<Program>& context : contexts) {
+            context.beginSuperstep(step, aggregated.data());
+        }
+
+        #pragma omp parallel num_threads(contexts.size())
+        {
+            DistributedContext<Program>& context = contexts[omp_get_thread_num()];
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < localN; ++i) {
+                if (step > 0) {
+                    outMessages.combineReceived(inbox, i);
+                    if (Program::IN_EDGES) {
+                        inMessages.combineReceived(inbox, i);
+                    }
+                }
+                outMessages.reset(i);
+                if (Program::IN_EDGES) {
+                    inMessages.reset(i);
+                }
+                if (step == 0 || !Program::VOTES_TO_HALT || !halted[i] || inbox.received[i]) {
+                    bool halting = context.run(program, i, localVertices[i], localValues[i], messagesOf<Program>(inbox, i));
+                    if (Program::VOTES_TO_HALT) {
+                        halted[i] = halting;
+                    }
+                }
+            }
+        }
+
+        std::fill(localTotals.begin(), localTotals.end(), 0.0);
+        bool sentDirect = false;
+        for (DistributedContext<Program>& context : contexts) {
+            for (int k = 0; k < Program::AGGREGATORS; ++k) {
+                localTotals[k] += context.aggregates[k];
+            }
+            localTotals[Program::AGGREGATORS] += context.active;
+            localTotals[Program::AGGREGATORS + 1] += context.sent ? 1.0 : 0.0;
+            localTotals[Program::AGGREGATORS + 2] += context.remoteTargets.size();
+            sentDirect = sentDirect || context.sentDirect;
+            context.sentDirect = false;
+        }
+
+        // Only the master thread talks to MPI (MPI_THREAD_FUNNELED)
+        requests.clear();
+        outMessages.fillSendSlots();
+        outMessages.startExchange(requests);
+        if (Program::IN_EDGES) {
+            inMessages.fillSendSlots();
+            inMessages.startExchange(requests);
+        }
+        requests.emplace_back();
+        MPI_Iallreduce(localTotals.data(), totals.data(), TOTALS, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &requests.back());
+
+        // Combine local messages while the remote ones are in flight, testing
+        // between blocks so the exchange keeps progressing
+        for (int blockStart = 0; blockStart < localN; blockStart += OVERLAP_BLOCK) {
+            int blockEnd = std::min(blockStart + OVERLAP_BLOCK, localN);
+
+            #pragma omp parallel for schedule(dynamic, 256)
+            for (int i = blockStart; i < blockEnd; ++i) {
+                outMessages.combineLocal(nextInbox, i, true);
+                if (Program::IN_EDGES) {
+                    inMessages.combineLocal(nextInbox, i, false);
+                }
+            }
+
+            int done;
+            MPI_Testall(requests.size(), requests.data(), &done, MPI_STATUSES_IGNORE);
+        }
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+        if (sentDirect) {
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < localN; ++i) {
+                if (directInbox.received[i]) {
+                    nextInbox.send(i, directInbox.values[i]);
+                    directInbox.values[i] = Program::Combiner::identity();
+                    directInbox.received[i] = 0;
+                }
+            }
+        }
+        if (totals[Program::AGGREGATORS + 2] > 0.0) {
+            exchangeDirectMessages(contexts, partition, size, nextInbox);
+        }
+        aggregated.assign(totals.begin(), totals.begin() + Program::AGGREGATORS);
+        inbox.swap(nextInbox);
+
+        if (step > 0) {
+            stats.supersteps = step;
+            stats.aggregated = aggregated;
+            if (program.halt(aggregated.data())) {
+                break;
+            }
+        }
+        if (totals[Program::AGGREGATORS] == 0.0 && totals[Program::AGGREGATORS + 1] == 0.0) {
+            break;
+        }
+    }
+
+    values = gatherVertexValues(partition, localValues, mpiType<Value>(), n, rank, size);
+    return stats;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "pregel.h"
+
+// PageRank with synchronous (Jacobi) updates, as in the distributed engine:
+// every superstep computes the ranks from the messages and dangling mass of
+// the previous one. Halts once the L1 change drops below epsilon.
+struct PageRankProgram {
+    using Value = double;
+    using Message = double;
+    using Combiner = SumCombiner<double>;
+    static const int AGGREGATORS = 2;
+    static const bool IN_EDGES = false;
+    static const bool VOTES_TO_HALT = false;
+
+    enum { RESIDUAL, DANGLING_MASS };
+
+    double damping = 0.85;
+    double epsilon = 0.0;
+
+    template <typename Context>
+    void share(Context& context, double rank) const {
+        int degree = context.outDegree();
+        if (degree == 0) {
+            context.aggregate(DANGLING_MASS, rank);
+        } else {
+            context.sendToOutNeighbours(rank / degree);
+        }
+    }
+
+    template <typename Context>
+    void initialize(Context& context, int, Value& value) const {
+        value = 1.0 / context.vertexCount();
+        share(context, value);
+    }
+
+    template <typename Context>
+    void compute(Context& context, int, Value& value, ArrayRange<Message> messages) const {
+        int n = context.vertexCount();
+        double sum = 0.0;
+        for (double message : messages) {
+            sum += message;
+        }
+
+        double rank = (1.0 - damping) / n + damping * sum + damping * context.aggregated(DANGLING_MASS) / n;
+        context.aggregate(RESIDUAL, fabs(rank - value));
+        value = rank;
+        share(context, value);
+    }
+
+    bool halt(const double* aggregated) const {
+        return aggregated[RESIDUAL] < epsilon;
+    }
+};
+
+// Weakly connected components by label propagation (HashMin): every vertex
+// takes the smallest id it hears of along edges in either direction
+struct ConnectedComponentsProgram {
+    using Value = int;
+    using Message = int;
+    using Combiner = MinCombiner<int>;
+    static const int AGGREGATORS = 1;
+    static const bool IN_EDGES = true;
+    static const bool VOTES_TO_HALT = true;
+
+    enum { CHANGED };
+
+    template <typename Context>
+    void initialize(Context& context, int v, Value& value) const {
+        value = v;
+        context.sendToOutNeighbours(value);
+        context.sendToInNeighbours(value);
+        context.voteToHalt();
+    }
+
+    template <typename Context>
+    void compute(Context& context, int, Value& value, ArrayRange<Message> messages) const {
+        int label = value;
+        for (int message : messages) {
+            label = std::min(label, message);
+        }
+        if (label < value) {
+            value = label;
+            context.aggregate(CHANGED, 1.0);
+            context.sendToOutNeighbours(value);
+            context.sendToInNeighbours(value);
+        }
+        context.voteToHalt();
+    }
+
+    bool halt(const double*) const {
+        return false;
+    }
+};
+
+// Single-source shortest paths (hop counts, the graph has no weights) by
+// Bellman-Ford relaxation from source; unreachable vertices stay at infinity
+struct ShortestPathsProgram {
+    using Value = double;
+    using Message = double;
+    using Combiner = MinCombiner<double>;
+    static const int AGGREGATORS = 1;
+    static const bool IN_EDGES = false;
+    static const bool VOTES_TO_HALT = true;
+
+    enum { CHANGED };
+
+    int source = 0;
+
+    template <typename Context>
+    void initialize(Context& context, int v, Value& value) const {
+        value = std::numeric_limits<double>::infinity();
+        if (v == source) {
+            value = 0.0;
+            context.sendToOutNeighbours(value + 1.0);
+        }
+        context.voteToHalt();
+    }
+
+    template <typename Context>
+    void compute(Context& context, int, Value& value, ArrayRange<Message> messages) const {
+        double distance = value;
+        for (double message : messages) {
+            distance = std::min(distance, message);
+        }
+        if (distance < value) {
+            value = distance;
+            context.aggregate(CHANGED, 1.0);
+            context.sendToOutNeighbours(value + 1.0);
+        }
+        context.voteToHalt();
+    }
+
+    bool halt(const double*) const {
+        return false;
+    }
+};
@@ -1,47 +1,26 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <string>
 #include <chrono>
+#include <cmath>
+
+#include "../common/checkpoint.h"
+#include "../common/frontier.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "../common/message_store.h"
+#include "../common/reorder.h"
 
 using namespace std;
 using namespace std::chrono;
 
 const double DAMPING = 0.85;
 
-void loadInput(const string& filename, unordered_map<string, int>& pageIds, vector<string>& pageNames, vector<vector<int>>& outEdges) {
-    ifstream file(filename);
-    string line, word;
-
-    auto getId = [&](const string& s) {
-        if (!pageIds.count(s)) {
-            int idx = pageIds.size();
-            pageIds[s] = idx;
-            pageNames.push_back(s);
-            outEdges.emplace_back();
-        }
-        return pageIds[s];
-    };
-
-    int v, u;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        ss >> word;
-        u = getId(word);
-
-        while (ss >> word) {
-            v = getId(word);
-            outEdges[u].push_back(v);
-        }
-    }
-}
-
-void generateOutput(const string& filename, const vector<double>& pageRanks, const vector<string>& pageNames, long long executionTime) {
+void generateOutput(const string& filename, const vector<double>& pageRanks, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime, long long reorderTime) {
     ofstream outFile(filename);
 
-    outFile << executionTime << endl;
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << " " << reorderTime << endl;
     for (size_t i = 0; i < pageRanks.size(); ++i) {
         outFile << pageNames[i] << " " << pageRanks[i] << endl;
     }
@@ -49,79 +28,419 @@ void generateOutput(const string& filename, const vector<double>& pageRanks, con
     outFile.close();
 }
 
-vector<double> rankPages(const unordered_map<string, int>& pageIds, const vector<string>& pageNames, const vector<vector<int>>& outEdges, int maxSupersteps) {
-    int n = pageIds.size();
+// Ranks and messages are stored as Rank (float or double), sums are
+// always accumulated in double. Messages go to pooled stores sized at load,
+// so supersteps do not allocate: a MessageStore keeps every message, a
+// CombinedMessageStore folds them at send time. A checkpoint holds the ranks
+// and every vertex's summed inbox, which resumes as a single message.
+template <typename Rank, typename Messages>
+vector<Rank> rankPages(const Graph& graph, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
 
-    vector<double> pageRanks(n, 1.0 / n);
-    vector<double> nextPageRanks(n, 0.0);
-    vector<vector<double>> inbox(n);
-    vector<vector<double>> outbox(n);
+    vector<Rank> pageRanks(n, 1.0 / n);
+    vector<Rank> nextPageRanks(n, 0.0);
+    Messages inbox, outbox;
+    inbox.allocate(graph);
+    outbox.allocate(graph);
 
     double danglingMass, sum, share, danglingShare;
     bool messagesSent = true;
+    bool converged = false;
 
-    for (int step = 0; step < maxSupersteps && messagesSent; ++step) {
+    supersteps = 0;
+    residual = 0.0;
+
+    if (checkpoints.resume) {
+        Checkpoint checkpoint;
+        readCheckpoint(checkpoints.path, n, 2, checkpoint);
+        copyFromCheckpoint(checkpoint.vector(0), n, pageRanks.data());
+        for (int v = 0; v < n; ++v) {
+            if (checkpoint.vector(1)[v] != 0.0) {
+                inbox.send(v, checkpoint.vector(1)[v]);
+            }
+        }
+        supersteps = checkpoint.header.superstep;
+        residual = checkpoint.header.scalars[0];
+        converged = supersteps > 0 && residual < epsilon;
+    }
+    CheckpointWriter checkpointWriter(checkpoints, n, 2);
+
+    for (int step = supersteps; step < maxSupersteps && messagesSent && !converged; ++step) {
         danglingMass = 0.0;
         messagesSent = false;
 
         for (int v = 0; v < n; ++v) {
             sum = 0.0;
-            for (double msg : inbox[v]) {
-                sum += msg;
+            for (const Rank* msg = inbox.begin(v); msg != inbox.end(v); ++msg) {
+                sum += *msg;
             }
 
             nextPageRanks[v] = (1.0 - DAMPING) / n + DAMPING * sum;
 
-            if (outEdges[v].empty()) {
+            int start = graph.offsets[v];
+            int end = graph.offsets[v + 1];
+
+            if (start == end) {
                 danglingMass += pageRanks[v];
             } else {
-                share = pageRanks[v] / outEdges[v].size();
-                for (int u : outEdges[v]) {
-                    outbox[u].push_back(share);
+                share = pageRanks[v] / (end - start);
+                for (int i = start; i < end; ++i) {
+                    outbox.send(graph.edges[i], share);
                     messagesSent = true;
                 }
             }
         }
 
         danglingShare = DAMPING * danglingMass / n;
+        residual = 0.0;
 
         for (int v = 0; v < n; ++v) {
             nextPageRanks[v] += danglingShare;
+            residual += fabs(nextPageRanks[v] - pageRanks[v]);
         }
 
         inbox.swap(outbox);
-        for (auto& box : outbox) {
-            box.clear();
-        }
+        outbox.clear();
 
         pageRanks.swap(nextPageRanks);
         fill(nextPageRanks.begin(), nextPageRanks.end(), 0.0);
+
+        supersteps = step + 1;
+        converged = residual < epsilon;
+
+        if (checkpoints.due(supersteps)) {
+            Checkpoint& checkpoint = checkpointWriter.beginSnapshot(supersteps);
+            copyToCheckpoint(pageRanks.data(), n, checkpoint.vector(0));
+            for (int v = 0; v < n; ++v) {
+                sum = 0.0;
+                for (const Rank* msg = inbox.begin(v); msg != inbox.end(v); ++msg) {
+                    sum += *msg;
+                }
+                checkpoint.vector(1)[v] = sum;
+            }
+            checkpoint.header.scalars[0] = residual;
+            checkpointWriter.commitSnapshot();
+        }
+    }
+    checkpointWriter.finish();
+
+    return pageRanks;
+}
+
+// Same supersteps in one pass over the vertices. Stored ranks leave out the
+// dangling share, which is carried as a scalar and added when a rank is read,
+// so the previous step's residual is also taken in this pass (one step late,
+// the last one in a final completion pass). Messages are combined into flat
+// inbox/outbox sums; the pass zeroes each inbox entry it consumes, so after
+// the swap the outbox starts empty without a separate fill.
+template <typename Rank>
+vector<Rank> rankPagesFused(const Graph& graph, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
+
+    vector<Rank> baseRanks(n, 1.0 / n);
+    vector<Rank> otherBaseRanks(n, 0.0);
+    vector<Rank> inbox(n, 0.0);
+    vector<Rank> outbox(n, 0.0);
+
+    double pendingShare = 0.0;
+    double previousShare = 0.0;
+    bool messagesSent = true;
+    bool converged = false;
+
+    supersteps = 0;
+    residual = 0.0;
+
+    for (int step = 0; step < maxSupersteps && messagesSent; ++step) {
+        double danglingMass = 0.0;
+        double previousResidual = 0.0;
+        messagesSent = false;
+
+        for (int v = 0; v < n; ++v) {
+            Rank rank = baseRanks[v] + pendingShare;
+            if (step > 0) {
+                previousResidual += fabs(rank - Rank(otherBaseRanks[v] + previousShare));
+            }
+
+            otherBaseRanks[v] = (1.0 - DAMPING) / n + DAMPING * double(inbox[v]);
+            inbox[v] = 0.0;
+
+            int start = graph.offsets[v];
+            int end = graph.offsets[v + 1];
+
+            if (start == end) {
+                danglingMass += rank;
+            } else {
+                double share = rank / (end - start);
+                for (int i = start; i < end; ++i) {
+                    outbox[graph.edges[i]] += share;
+                }
+                messagesSent = true;
+            }
+        }
+
+        // The residual of step - 1 is now known; if it converged, the ranks
+        // of that step are still intact in baseRanks and pendingShare
+        if (step > 0) {
+            residual = previousResidual;
+            converged = residual < epsilon;
+            if (converged) {
+                break;
+            }
+        }
+
+        baseRanks.swap(otherBaseRanks);
+        inbox.swap(outbox);
+        previousShare = pendingShare;
+        pendingShare = DAMPING * danglingMass / n;
+        supersteps = step + 1;
+    }
+
+    // Completion pass: add the pending share and, unless the loop already
+    // stopped on it, take the residual of the last step
+    bool residualPending = supersteps > 0 && !converged;
+    double lastResidual = 0.0;
+    for (int v = 0; v < n; ++v) {
+        Rank rank = baseRanks[v] + pendingShare;
+        if (residualPending) {
+            lastResidual += fabs(rank - Rank(otherBaseRanks[v] + previousShare));
+        }
+        baseRanks[v] = rank;
+    }
+    if (residualPending) {
+        residual = lastResidual;
+    }
+
+    return baseRanks;
+}
+
+// Delta-PageRank: pushes pending rank changes over an active-vertex frontier
+// instead of recomputing every vertex. With c = (1 - d) / n the ranks are
+// (c + g) * z, where z = 1 + d * M * z sums the damped walks along out-edges
+// of non-dangling vertices and g, the dangling share, follows from z in
+// closed form, so dangling mass never wakes up the whole graph. z is solved
+// by residual pushing: an active vertex settles its pending change and passes
+// d / degree of it to each out-neighbour. A vertex votes to halt while its
+// pending change is at most threshold / n in rank terms and is woken by
+// messages that push it above. Sparse frontiers push from a queue, dense
+// ones pull over in-edges against the frontier bitmap.
+template <typename Rank>
+vector<Rank> rankPagesDelta(const Graph& graph, int maxSupersteps, double threshold, int& supersteps, double& residual) {
+    int n = graph.n;
+
+    vector<Rank> settled(n, 0.0);
+    vector<Rank> pending(n, 1.0);
+    vector<Rank> shares(n, 0.0);
+    vector<char> touched(n, 0);
+    vector<int> candidates;
+
+    double activeThreshold = threshold / (1.0 - DAMPING);
+    auto active = [&](int v) {
+        return pending[v] > activeThreshold;
+    };
+
+    Frontier frontier, next;
+    frontier.allocate(n);
+    next.allocate(n);
+    frontier.assignBitmap(graph.offsets, active);
+    frontier.adapt(graph.m);
+
+    long long activations = 0;
+    int denseSupersteps = 0;
+    supersteps = 0;
+
+    for (int step = 0; step < maxSupersteps && !frontier.empty(); ++step) {
+        activations += frontier.count;
+
+        auto settle = [&](int u) {
+            settled[u] += pending[u];
+            int degree = graph.outDegree(u);
+            shares[u] = degree > 0 ? DAMPING * double(pending[u]) / degree : 0.0;
+            pending[u] = 0.0;
+        };
+
+        if (frontier.dense) {
+            ++denseSupersteps;
+            for (int u = 0; u < n; ++u) {
+                if (frontier.contains(u)) {
+                    settle(u);
+                }
+            }
+
+            // Pull: every vertex gathers the shares of its active in-neighbours
+            for (int v = 0; v < n; ++v) {
+                double sum = 0.0;
+                for (int i = graph.inOffsets[v]; i < graph.inOffsets[v + 1]; ++i) {
+                    int u = graph.inEdges[i];
+                    if (frontier.contains(u)) {
+                        sum += shares[u];
+                    }
+                }
+                pending[v] += sum;
+            }
+            next.assignBitmap(graph.offsets, active);
+        } else {
+            for (int u : frontier.vertices) {
+                settle(u);
+            }
+
+            // Push from the queue; only vertices that received can wake up
+            for (int u : frontier.vertices) {
+                Rank share = shares[u];
+                for (int i = graph.offsets[u]; i < graph.offsets[u + 1]; ++i) {
+                    int v = graph.edges[i];
+                    pending[v] += share;
+                    if (!touched[v]) {
+                        touched[v] = 1;
+                        candidates.push_back(v);
+                    }
+                }
+            }
+            for (int v : candidates) {
+                touched[v] = 0;
+                if (active(v)) {
+                    next.vertices.push_back(v);
+                }
+            }
+            candidates.clear();
+            next.assignQueue(graph.offsets);
+        }
+
+        next.adapt(graph.m);
+        frontier.swap(next);
+        next.clear();
+        supersteps = step + 1;
+    }
+
+    // g = d * (c + g) * S / n, with S the settled sum of the dangling vertices
+    double danglingSettled = 0.0;
+    double pendingTotal = 0.0;
+    for (int v = 0; v < n; ++v) {
+        if (graph.outDegree(v) == 0) {
+            danglingSettled += settled[v];
+        }
+        pendingTotal += pending[v];
+    }
+    double teleport = (1.0 - DAMPING) / n;
+    double scale = teleport / (1.0 - DAMPING * danglingSettled / n);
+
+    vector<Rank> pageRanks(n);
+    for (int v = 0; v < n; ++v) {
+        pageRanks[v] = scale * settled[v];
     }
+    residual = scale * pendingTotal;
 
+    cout << "Delta mode: " << activations << " vertex updates in " << supersteps << " supersteps ("
+         << (supersteps > 0 ? 100.0 * activations / ((double)n * supersteps) : 0.0) << "% of a full sweep each), "
+         << denseSupersteps << " dense" << endl;
     return pageRanks;
 }
 
+// The fused pass already sums messages into one value per vertex
+template <typename Rank>
+vector<Rank> runPageRank(const Graph& graph, bool fused, bool combine, bool delta, double deltaThreshold, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    if (delta) {
+        return rankPagesDelta<Rank>(graph, maxSupersteps, deltaThreshold, supersteps, residual);
+    } else if (fused) {
+        return rankPagesFused<Rank>(graph, maxSupersteps, epsilon, supersteps, residual);
+    } else if (combine) {
+        return rankPages<Rank, CombinedMessageStore<Rank, SumCombiner<Rank>>>(graph, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+    }
+    return rankPages<Rank, MessageStore<Rank>>(graph, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
-        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS>" << endl;
+        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--epsilon <EPSILON>] [--input <GRAPH_FILE>] [--precision double|float] [--reorder degree|rcm|gorder] [--fused] [--combine] [--delta <THRESHOLD>] [--checkpoint <SUPERSTEPS>] [--checkpoint-file <PATH>] [--resume]" << endl;
         return 1;
     }
     int maxSupersteps = atoi(argv[1]);
 
-    unordered_map<string, int> pageIds;
-    vector<string> pageNames;
-    vector<vector<int>> outEdges;
-
     string inputFile = "/app/input/graph.txt";
-    loadInput(inputFile, pageIds, pageNames, outEdges);
+    double epsilon = 0.0;
+    bool singlePrecision = false;
+    VertexOrder vertexOrder = ORIGINAL_ORDER;
+    bool fused = false;
+    bool combine = false;
+    bool delta = false;
+    double deltaThreshold = 0.0;
+    CheckpointOptions checkpoints;
+    checkpoints.path = "/app/output/sequential.checkpoint";
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--precision" && i + 1 < argc) {
+            singlePrecision = string(argv[++i]) == "float";
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertexOrder = parseVertexOrder(argv[++i]);
+        } else if (arg == "--fused") {
+            fused = true;
+        } else if (arg == "--combine") {
+            combine = true;
+        } else if (arg == "--delta" && i + 1 < argc) {
+            delta = true;
+            deltaThreshold = atof(argv[++i]);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoints.interval = max(0, atoi(argv[++i]));
+        } else if (arg == "--checkpoint-file" && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (arg == "--resume") {
+            checkpoints.resume = true;
+        }
+    }
+
+    // Only the per-message supersteps keep their state in checkpoints
+    if ((fused || delta) && (checkpoints.interval > 0 || checkpoints.resume)) {
+        cerr << "Error: checkpoints are not supported with --fused and --delta, drop --checkpoint and --resume" << endl;
+        return 1;
+    }
+
+    PageNames pageNames;
+    Graph graph;
+
+    auto loadStart = high_resolution_clock::now();
+    loadGraph(inputFile, pageNames, graph);
+
+    // Relabel for locality, ranks are mapped back to the original ids below
+    auto reorderStart = high_resolution_clock::now();
+    vector<int> newIds;
+    if (vertexOrder != ORIGINAL_ORDER) {
+        newIds = reorderGraph(graph, vertexOrder);
+    }
+    long long reorderTime = duration_cast<milliseconds>(high_resolution_clock::now() - reorderStart).count();
+
+    // Dense delta supersteps pull over in-edges
+    if (delta) {
+        buildInEdges(graph);
+    }
+    auto loadEnd = high_resolution_clock::now();
+    long long loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count() - reorderTime;
+
+    int supersteps;
+    double residual;
 
     auto start = high_resolution_clock::now();
-    vector<double> pageRanks = rankPages(pageIds, pageNames, outEdges, maxSupersteps);
+    vector<double> pageRanks;
+    if (singlePrecision) {
+        vector<float> singlePageRanks = runPageRank<float>(graph, fused, combine, delta, deltaThreshold, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+        pageRanks.assign(singlePageRanks.begin(), singlePageRanks.end());
+    } else {
+        pageRanks = runPageRank<double>(graph, fused, combine, delta, deltaThreshold, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+    }
     auto end = high_resolution_clock::now();
     long long executionTime =duration_cast<milliseconds>(end - start).count();
 
-    string outputFile = "/app/output/sequential_" + to_string(maxSupersteps) + ".txt";
-    generateOutput(outputFile, pageRanks, pageNames, executionTime);
+    if (vertexOrder != ORIGINAL_ORDER) {
+        auto restoreStart = high_resolution_clock::now();
+        pageRanks = restoreOrder(pageRanks, newIds);
+        reorderTime += duration_cast<milliseconds>(high_resolution_clock::now() - restoreStart).count();
+        cout << "Reordered vertices (" << vertexOrderName(vertexOrder) << ") in " << reorderTime << " ms" << endl;
+    }
+
+    string outputFile = "/app/output/sequential_" + string(delta ? "delta_" : fused ? "fused_" : combine ? "combined_" : "") + string(singlePrecision ? "float_" : "") + (vertexOrder != ORIGINAL_ORDER ? string(vertexOrderName(vertexOrder)) + "_" : string()) + to_string(maxSupersteps) + ".txt";
+    generateOutput(outputFile, pageRanks, pageNames, executionTime, supersteps, residual, loadTime, reorderTime);
 
     return 0;
 }
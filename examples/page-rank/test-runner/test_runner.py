@@ -6,11 +6,95 @@ SEQUENTIAL_PAGE_RANK = "./page-rank/pageRankSequential"
 PARALLEL_PAGE_RANK = "./page-rank/pageRankParallel"
 DISTRIBUTED_PAGE_RANK = "./page-rank/pageRankDistributed"
 ACCELERATED_PAGE_RANK = "./page-rank/pageRankAccelerated"
+VECTORIZED_PAGE_RANK = "./page-rank/pageRankVectorized"
+PREGEL_PAGE_RANK = "./page-rank/pageRankPregel"
+GRAPH_CONVERTER = "./page-rank/graphConverter"
 
+TEXT_INPUT = "./input/graph.txt"
+BINARY_INPUT = "./input/graph.bin"
 OUTPUT_DIR = "./output"
 
 SUPERSTEPS_LIST = [10, 100, 1000, 10000, 100000]
 MPI_PROCESSES = 4
+# OpenMP threads inside every MPI process; hybrid runs use e.g. one process
+# per node or socket and as many threads as it has cores
+THREADS_PER_PROCESS = 1
+
+# Vertex to process assignment of the distributed engine: vertex, edge, hash or ldg
+PARTITION_STRATEGY = "vertex"
+
+# Residual (L1) below which the engines halt early, 0 disables the check
+EPSILON = 0.0
+
+# Rerun every engine with single precision ranks at one superstep count and
+# compare against the double precision output
+VALIDATE_FLOAT_PRECISION = True
+PRECISION_SUPERSTEPS = 100
+PRECISION_TOLERANCE = 1e-4
+
+# Vertex orders benchmarked against the original order at REORDER_SUPERSTEPS,
+# empty disables the comparison
+REORDER_STRATEGIES = ["degree", "rcm", "gorder"]
+REORDER_SUPERSTEPS = 1000
+
+# Vertex loop schedules of the parallel engine compared against the default
+# equal vertex blocks; each run prints per-thread busy and idle times with
+# --report-threads
+LOOP_SCHEDULES = ["edge", "dynamic"]
+
+# Compare the fused single-pass superstep with the current one in the
+# sequential and parallel engines
+BENCHMARK_FUSED = True
+
+# Compare the sequential engine with messages combined at send time against
+# storing every message
+BENCHMARK_COMBINER = True
+
+# Delta-PageRank thresholds run on the sequential and parallel engines, each
+# compared with the converged run of DELTA_SUPERSTEPS supersteps
+DELTA_THRESHOLDS = [1e-4, 1e-6, 1e-9]
+DELTA_SUPERSTEPS = 1000
+
+# Asynchronous (Gauss-Seidel) modes of the parallel engine, without and with
+# priority order, run to ASYNC_EPSILON against the BSP push and pull modes;
+# ASYNC_MAX_SUPERSTEPS stays out of SUPERSTEPS_LIST so the BSP runs to
+# epsilon do not replace the plotted ones
+ASYNC_MODES = [["--async"], ["--priority"]]
+ASYNC_EPSILON = 1e-10
+ASYNC_MAX_SUPERSTEPS = 50000
+
+# Backends of the generic Pregel runtime, benchmarked on PageRank against the
+# hand-written engines, and the other vertex programs run once on each until
+# every vertex has halted
+PREGEL_BACKENDS = ["sequential", "openmp", "mpi"]
+PREGEL_ALGORITHMS = ["components", "sssp"]
+PREGEL_MAX_SUPERSTEPS = 100000
+
+# Parity of Pregel PageRank with the hand-written engines: every backend's
+# ranks must be within PREGEL_PARITY_TOLERANCE (L1) of the distributed
+# engine's, which uses the same synchronous updates, or the test run fails.
+# The slowdown of the best of PREGEL_PARITY_REPEATS runs against the engine's
+# is only reported: wall-clock noise on a shared host exceeds any useful
+# margin. Setting PREGEL_PARITY_SLOWDOWN > 0 makes it a limit as well.
+PREGEL_PARITY_SUPERSTEPS = 1000
+PREGEL_PARITY_REPEATS = 3
+PREGEL_PARITY_SLOWDOWN = 0
+PREGEL_PARITY_TOLERANCE = 1e-9
+
+# Checkpoint every CHECKPOINT_INTERVAL supersteps in runs of
+# CHECKPOINT_SUPERSTEPS: the time against the same run without checkpoints,
+# and a run stopped halfway and resumed against the uninterrupted one;
+# 0 disables the benchmark
+CHECKPOINT_INTERVAL = 100
+CHECKPOINT_SUPERSTEPS = 1000
+
+# NUMA nodes (sockets) the parallel engine's NUMA mode is scaled across, with
+# all CPUs of the first 1 .. NUMA_NODES nodes; 0 disables the benchmark
+NUMA_NODES = 2
+NUMA_SUPERSTEPS = 1000
+
+# Convert the text graph once and let every run map the binary CSR file
+USE_BINARY_INPUT = True
 
 def run_test(cmd, test_name):
     print(f"Running - {test_name}...", flush=True)
@@ -21,9 +105,23 @@ def run_test(cmd, test_name):
         print(f"Failed - {test_name}\n", flush=True)
         print(e, flush=True)
 
+def engine_args(supersteps):
+    args = [str(supersteps)]
+    if USE_BINARY_INPUT:
+        args += ["--input", BINARY_INPUT]
+    if EPSILON > 0:
+        args += ["--epsilon", str(EPSILON)]
+    return args
+
 def read_execution_time(filepath):
+    # Header line: <execution time> <supersteps> <residual> <load time> [<reorder time>]
     with open(filepath, "r") as f:
-        return float(f.readline().strip())
+        return float(f.readline().split()[0])
+
+def read_header(filepath):
+    with open(filepath, "r") as f:
+        fields = f.readline().split()
+    return float(fields[0]), int(fields[1]), float(fields[4]) if len(fields) > 4 else 0.0
 
 def collect_execution_times(prefix):
     execution_times = []
@@ -33,12 +131,344 @@ def collect_execution_times(prefix):
         execution_times.append(read_execution_time(path))
     return execution_times
 
-def plot_execution_times(supersteps, sequential_execution_times, parallel_execution_times, distributed_execution_times, accelerated_execution_times):
+def read_page_ranks(filepath):
+    with open(filepath, "r") as f:
+        f.readline()
+        return [float(line.split()[-1]) for line in f]
+
+def validate_precision(prefix):
+    # L1 distance between the single and double precision ranks
+    double_path = os.path.join(OUTPUT_DIR, f"{prefix}_{PRECISION_SUPERSTEPS}.txt")
+    float_path = os.path.join(OUTPUT_DIR, f"{prefix}_float_{PRECISION_SUPERSTEPS}.txt")
+    try:
+        double_ranks = read_page_ranks(double_path)
+        float_ranks = read_page_ranks(float_path)
+    except OSError as e:
+        print(f"Precision check skipped - {prefix}: {e}\n", flush=True)
+        return
+    difference = sum(abs(d - f) for d, f in zip(double_ranks, float_ranks))
+    status = "OK" if len(double_ranks) == len(float_ranks) and difference < PRECISION_TOLERANCE else "FAILED"
+    print(f"Precision check {status} - {prefix}: L1 difference {difference:.3g} (tolerance {PRECISION_TOLERANCE})\n", flush=True)
+
+def report_reordering(prefix):
+    # Per-superstep time of every vertex order against the original order,
+    # and the supersteps after which the reordering has paid for itself
+    try:
+        base_time, base_supersteps, _ = read_header(os.path.join(OUTPUT_DIR, f"{prefix}_{REORDER_SUPERSTEPS}.txt"))
+    except OSError as e:
+        print(f"Reorder report skipped - {prefix}: {e}\n", flush=True)
+        return
+    base_step = base_time / max(1, base_supersteps)
+    for order in REORDER_STRATEGIES:
+        try:
+            time, supersteps, reorder_time = read_header(os.path.join(OUTPUT_DIR, f"{prefix}_{order}_{REORDER_SUPERSTEPS}.txt"))
+        except OSError as e:
+            print(f"Reorder report skipped - {prefix} {order}: {e}\n", flush=True)
+            continue
+        step = time / max(1, supersteps)
+        speedup = base_step / step if step > 0 else float("inf")
+        saved = base_step - step
+        break_even = f"{reorder_time / saved:.0f} supersteps" if saved > 0 else "never"
+        print(f"Reorder {prefix} {order}: cost {reorder_time:.0f} ms, per-superstep {step:.3f} ms vs {base_step:.3f} ms, speedup {speedup:.2f}x, break-even after {break_even}\n", flush=True)
+
+def report_combiner():
+    # Time of the combined runs against the per-message ones, and the L1
+    # distance between their ranks
+    for supersteps in SUPERSTEPS_LIST:
+        try:
+            base_path = os.path.join(OUTPUT_DIR, f"sequential_{supersteps}.txt")
+            combined_path = os.path.join(OUTPUT_DIR, f"sequential_combined_{supersteps}.txt")
+            base_time = read_execution_time(base_path)
+            combined_time = read_execution_time(combined_path)
+            difference = sum(abs(b - c) for b, c in zip(read_page_ranks(base_path), read_page_ranks(combined_path)))
+        except OSError as e:
+            print(f"Combiner report skipped - {supersteps} supersteps: {e}\n", flush=True)
+            continue
+        speedup = base_time / combined_time if combined_time > 0 else float("inf")
+        print(f"Combiner sequential {supersteps} supersteps: {combined_time:.0f} ms vs {base_time:.0f} ms, speedup {speedup:.2f}x, L1 difference {difference:.3g}\n", flush=True)
+
+def report_delta(threshold):
+    # Time and supersteps of the delta runs against the full sweeps, and the
+    # L1 distance between their ranks
+    for prefix in ["sequential", "parallel"]:
+        try:
+            base_path = os.path.join(OUTPUT_DIR, f"{prefix}_{DELTA_SUPERSTEPS}.txt")
+            delta_path = os.path.join(OUTPUT_DIR, f"{prefix}_delta_{DELTA_SUPERSTEPS}.txt")
+            base_time, base_supersteps, _ = read_header(base_path)
+            delta_time, delta_supersteps, _ = read_header(delta_path)
+            difference = sum(abs(b - d) for b, d in zip(read_page_ranks(base_path), read_page_ranks(delta_path)))
+        except OSError as e:
+            print(f"Delta report skipped - {prefix}: {e}\n", flush=True)
+            continue
+        speedup = base_time / delta_time if delta_time > 0 else float("inf")
+        print(f"Delta {prefix} threshold {threshold:g}: {delta_time:.0f} ms in {delta_supersteps} supersteps vs {base_time:.0f} ms in {base_supersteps}, speedup {speedup:.2f}x, L1 difference {difference:.3g}\n", flush=True)
+
+def async_args():
+    args = [str(ASYNC_MAX_SUPERSTEPS), "--epsilon", str(ASYNC_EPSILON)]
+    if USE_BINARY_INPUT:
+        args += ["--input", BINARY_INPUT]
+    return args
+
+def benchmark_async():
+    # Runs the asynchronous modes and the BSP ones to the same epsilon, after
+    # the plots in case ASYNC_MAX_SUPERSTEPS is also in SUPERSTEPS_LIST
+    run_test([PARALLEL_PAGE_RANK] + async_args(), f"Parallel to epsilon {ASYNC_EPSILON:g}")
+    run_test([PARALLEL_PAGE_RANK] + async_args() + ["--mode", "pull"], f"Parallel pull to epsilon {ASYNC_EPSILON:g}")
+    for mode in ASYNC_MODES:
+        run_test([PARALLEL_PAGE_RANK] + async_args() + mode, f"Parallel {mode[0][2:]} to epsilon {ASYNC_EPSILON:g}")
+    report_async()
+
+def report_async():
+    # Supersteps and time to ASYNC_EPSILON of every mode against BSP push
+    runs = [("BSP push", "parallel"), ("BSP pull", "parallel_pull"), ("async", "parallel_async"), ("async priority", "parallel_async_priority")]
+    try:
+        base_time, base_supersteps, _ = read_header(os.path.join(OUTPUT_DIR, f"parallel_{ASYNC_MAX_SUPERSTEPS}.txt"))
+    except OSError as e:
+        print(f"Async report skipped: {e}\n", flush=True)
+        return
+    for name, prefix in runs:
+        try:
+            time, supersteps, _ = read_header(os.path.join(OUTPUT_DIR, f"{prefix}_{ASYNC_MAX_SUPERSTEPS}.txt"))
+        except OSError as e:
+            print(f"Async report skipped - {name}: {e}\n", flush=True)
+            continue
+        speedup = base_time / time if time > 0 else float("inf")
+        print(f"Async {name} to epsilon {ASYNC_EPSILON:g}: {supersteps} supersteps vs {base_supersteps}, {time:.0f} ms vs {base_time:.0f} ms, speedup {speedup:.2f}x\n", flush=True)
+
+def checkpoint_engines():
+    distributed = ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), "--bind-to", "none", DISTRIBUTED_PAGE_RANK]
+    distributed_args = ["--partition", PARTITION_STRATEGY, "--threads", str(THREADS_PER_PROCESS)]
+    return [
+        ("sequential", [SEQUENTIAL_PAGE_RANK], []),
+        ("parallel", [PARALLEL_PAGE_RANK], []),
+        ("distributed", distributed, distributed_args),
+        ("accelerated", [ACCELERATED_PAGE_RANK], []),
+        ("vectorized", [VECTORIZED_PAGE_RANK], []),
+    ]
+
+def remove_output(path):
+    # So a failed run leaves no older output behind to be read as its own
+    try:
+        os.remove(path)
+    except FileNotFoundError:
+        pass
+
+def benchmark_checkpoints():
+    # Runs after the plots: these runs overwrite the engines' outputs of
+    # CHECKPOINT_SUPERSTEPS supersteps
+    halfway = CHECKPOINT_SUPERSTEPS // 2
+    for engine, command, args in checkpoint_engines():
+        path = os.path.join(OUTPUT_DIR, f"{engine}_{CHECKPOINT_SUPERSTEPS}.txt")
+        remove_output(path)
+        run_test(command + engine_args(CHECKPOINT_SUPERSTEPS) + args, f"{engine.capitalize()} ({CHECKPOINT_SUPERSTEPS} supersteps)")
+        try:
+            base_time = read_execution_time(path)
+            base_ranks = read_page_ranks(path)
+        except OSError as e:
+            print(f"Checkpoint report skipped - {engine}: {e}\n", flush=True)
+            continue
+
+        checkpoint_args = ["--checkpoint", str(CHECKPOINT_INTERVAL)]
+        remove_output(path)
+        run_test(command + engine_args(CHECKPOINT_SUPERSTEPS) + args + checkpoint_args, f"{engine.capitalize()} with checkpoints ({CHECKPOINT_SUPERSTEPS} supersteps)")
+        try:
+            checkpoint_time = read_execution_time(path)
+        except OSError as e:
+            print(f"Checkpoint report skipped - {engine}: {e}\n", flush=True)
+            continue
+        overhead = 100.0 * (checkpoint_time - base_time) / base_time if base_time > 0 else 0.0
+        print(f"Checkpoint {engine}: {checkpoint_time:.0f} ms with a checkpoint every {CHECKPOINT_INTERVAL} supersteps vs {base_time:.0f} ms without, overhead {overhead:.1f}%\n", flush=True)
+
+        # The resume must start from the halfway run's checkpoint, not the full run's
+        remove_output(os.path.join(OUTPUT_DIR, f"{engine}.checkpoint"))
+        run_test(command + engine_args(halfway) + args + checkpoint_args, f"{engine.capitalize()} with checkpoints ({halfway} supersteps)")
+        remove_output(path)
+        run_test(command + engine_args(CHECKPOINT_SUPERSTEPS) + args + ["--resume"], f"{engine.capitalize()} resumed ({CHECKPOINT_SUPERSTEPS} supersteps)")
+        try:
+            resumed_ranks = read_page_ranks(path)
+        except OSError as e:
+            print(f"Resume report skipped - {engine}: {e}\n", flush=True)
+            continue
+        difference = sum(abs(b - r) for b, r in zip(base_ranks, resumed_ranks))
+        print(f"Resume {engine}: stopped after {halfway} supersteps and resumed, L1 difference {difference:.3g} to the uninterrupted run\n", flush=True)
+
+def plot_numa_scaling():
+    # NUMA mode on 1 .. NUMA_NODES nodes against the default (unpinned,
+    # main thread first-touch) run on the whole machine. The engine names
+    # its output by the nodes it actually used, so counts the machine does
+    # not have are missing and skipped.
+    nodes = [k for k in range(1, NUMA_NODES + 1) if os.path.exists(os.path.join(OUTPUT_DIR, f"parallel_numa{k}_{NUMA_SUPERSTEPS}.txt"))]
+    try:
+        numa_times = [read_execution_time(os.path.join(OUTPUT_DIR, f"parallel_numa{k}_{NUMA_SUPERSTEPS}.txt")) for k in nodes]
+        default_time = read_execution_time(os.path.join(OUTPUT_DIR, f"parallel_{NUMA_SUPERSTEPS}.txt"))
+    except OSError as e:
+        print(f"NUMA scaling plot skipped: {e}\n", flush=True)
+        return
+    if not nodes:
+        print("NUMA scaling plot skipped: no NUMA mode runs\n", flush=True)
+        return
+
+    for k, time in zip(nodes, numa_times):
+        print(f"NUMA {k} node(s): {time:.0f} ms, speedup {numa_times[0] / time:.2f}x over 1 node, {default_time / time:.2f}x over default placement\n", flush=True)
+
+    plt.figure()
+    plt.plot(nodes, numa_times, marker="o", label="Parallel NUMA mode (OpenMP)", color="green")
+    plt.axhline(default_time, linestyle="--", label="Parallel default placement, all CPUs", color="gray")
+
+    plt.xlabel("NUMA nodes")
+    plt.ylabel("Execution time (ms)")
+    plt.title(f"PageRank NUMA Scaling ({NUMA_SUPERSTEPS} supersteps)")
+    plt.xticks(nodes)
+    plt.legend()
+    plt.grid(True)
+
+    plt.savefig(os.path.join(OUTPUT_DIR, "plots", "numa_scaling.png"), dpi=300)
+    plt.close()
+
+def plot_schedules(supersteps):
+    # Parallel execution time of every loop schedule, push and pull
+    plt.figure()
+    for mode, color in [("parallel", "green"), ("parallel_pull", "olive")]:
+        for schedule in ["vertex"] + LOOP_SCHEDULES:
+            style = {"vertex": "-", "edge": "--", "dynamic": ":"}[schedule]
+            prefix = mode if schedule == "vertex" else f"{mode}_{schedule}"
+            try:
+                times = collect_execution_times(prefix)
+            except OSError:
+                continue
+            plt.plot(supersteps, times, marker="o", linestyle=style, label=f"{mode.replace('_', ' ').capitalize()} ({schedule} schedule)", color=color)
+
+    plt.xlabel("Number of supersteps")
+    plt.ylabel("Execution time (ms)")
+    plt.title("PageRank OpenMP Loop Schedules")
+    plt.legend()
+    plt.grid(True)
+    plt.xscale("log")
+
+    plt.savefig(os.path.join(OUTPUT_DIR, "plots", "schedules.png"), dpi=300)
+    plt.close()
+
+def plot_fused(supersteps):
+    # Execution time of the current and the fused superstep, engine by engine
+    plt.figure()
+    for engine, color in [("sequential", "blue"), ("parallel", "green"), ("parallel_pull", "olive")]:
+        label = engine.replace("_", " ").capitalize()
+        plt.plot(supersteps, collect_execution_times(engine), marker="o", label=label, color=color)
+        plt.plot(supersteps, collect_execution_times(f"{engine}_fused"), marker="o", linestyle="--", label=f"{label} (fused)", color=color)
+
+    plt.xlabel("Number of supersteps")
+    plt.ylabel("Execution time (ms)")
+    plt.title("PageRank Fused Supersteps")
+    plt.legend()
+    plt.grid(True)
+    plt.xscale("log")
+
+    plt.savefig(os.path.join(OUTPUT_DIR, "plots", "fused.png"), dpi=300)
+    plt.close()
+
+def pregel_command(backend):
+    if backend == "mpi":
+        return ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), "--bind-to", "none", PREGEL_PAGE_RANK]
+    return [PREGEL_PAGE_RANK]
+
+def pregel_args(backend):
+    # The MPI backend partitions and threads like the distributed engine
+    args = ["--backend", backend]
+    if backend == "mpi":
+        args += ["--partition", PARTITION_STRATEGY, "--threads", str(THREADS_PER_PROCESS)]
+    return args
+
+def pregel_parity_engines():
+    # Hand-written engine of every backend: command, extra arguments, output prefix
+    distributed = ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), "--bind-to", "none", DISTRIBUTED_PAGE_RANK]
+    distributed_args = ["--partition", PARTITION_STRATEGY, "--threads", str(THREADS_PER_PROCESS)]
+    return {
+        "sequential": ([SEQUENTIAL_PAGE_RANK], ["--combine"], "sequential_combined"),
+        "openmp": ([PARALLEL_PAGE_RANK], [], "parallel"),
+        "mpi": (distributed, distributed_args, "distributed"),
+    }
+
+def check_pregel_parity():
+    # Runs after the plots: these runs overwrite the outputs of
+    # PREGEL_PARITY_SUPERSTEPS supersteps. Returns whether every backend passed.
+    supersteps = PREGEL_PARITY_SUPERSTEPS
+    engines = pregel_parity_engines()
+    command, args, _ = engines["mpi"]
+    reference_path = os.path.join(OUTPUT_DIR, f"distributed_{supersteps}.txt")
+    remove_output(reference_path)
+    run_test(command + engine_args(supersteps) + args, f"Distributed ({supersteps} supersteps)")
+    try:
+        reference = read_page_ranks(reference_path)
+    except OSError as e:
+        print(f"Pregel parity FAILED: {e}\n", flush=True)
+        return False
+
+    passed = True
+    for backend in PREGEL_BACKENDS:
+        command, args, prefix = engines[backend]
+        engine_path = os.path.join(OUTPUT_DIR, f"{prefix}_{supersteps}.txt")
+        pregel_path = os.path.join(OUTPUT_DIR, f"pregel_{backend}_pagerank_{supersteps}.txt")
+        engine_times, pregel_times = [], []
+        try:
+            for _ in range(PREGEL_PARITY_REPEATS):
+                remove_output(engine_path)
+                run_test(command + engine_args(supersteps) + args, f"{prefix.replace('_', ' ').capitalize()} ({supersteps} supersteps)")
+                engine_times.append(read_execution_time(engine_path))
+                remove_output(pregel_path)
+                run_test(pregel_command(backend) + engine_args(supersteps) + pregel_args(backend), f"Pregel {backend} PageRank ({supersteps} supersteps)")
+                pregel_times.append(read_execution_time(pregel_path))
+            ranks = read_page_ranks(pregel_path)
+        except OSError as e:
+            print(f"Pregel parity FAILED - {backend}: {e}\n", flush=True)
+            passed = False
+            continue
+
+        engine_time, pregel_time = min(engine_times), min(pregel_times)
+        slowdown = pregel_time / engine_time if engine_time > 0 else 1.0
+        difference = sum(abs(r - p) for r, p in zip(reference, ranks))
+        ok = len(ranks) == len(reference) and difference < PREGEL_PARITY_TOLERANCE
+        limit = ""
+        if PREGEL_PARITY_SLOWDOWN > 0:
+            ok = ok and slowdown <= PREGEL_PARITY_SLOWDOWN
+            limit = f" (limit {PREGEL_PARITY_SLOWDOWN})"
+        passed = passed and ok
+        print(f"Pregel parity {'OK' if ok else 'FAILED'} - {backend}: {pregel_time:.0f} ms vs {prefix} {engine_time:.0f} ms, slowdown {slowdown:.2f}x{limit}, L1 difference {difference:.3g} (tolerance {PREGEL_PARITY_TOLERANCE})\n", flush=True)
+    return passed
+
+def plot_pregel(supersteps):
+    # PageRank on every Pregel backend against the hand-written engine it
+    # corresponds to
+    plt.figure()
+    for backend, engine, color in [("sequential", "sequential_combined", "blue"), ("openmp", "parallel", "green"), ("mpi", "distributed", "red")]:
+        if backend not in PREGEL_BACKENDS:
+            continue
+        try:
+            engine_times = collect_execution_times(engine)
+            pregel_times = collect_execution_times(f"pregel_{backend}_pagerank")
+        except OSError:
+            continue
+        plt.plot(supersteps, engine_times, marker="o", label=engine.replace("_", " ").capitalize(), color=color)
+        plt.plot(supersteps, pregel_times, marker="o", linestyle="--", label=f"Pregel {backend}", color=color)
+
+    plt.xlabel("Number of supersteps")
+    plt.ylabel("Execution time (ms)")
+    plt.title("PageRank Pregel Runtime vs Hand-Written Engines")
+    plt.legend()
+    plt.grid(True)
+    plt.xscale("log")
+
+    plt.savefig(os.path.join(OUTPUT_DIR, "plots", "pregel.png"), dpi=300)
+    plt.close()
+
+def plot_execution_times(supersteps, sequential_execution_times, parallel_execution_times, parallel_pull_execution_times, distributed_execution_times, accelerated_execution_times, accelerated_pull_execution_times, vectorized_execution_times):
     plt.figure()
     plt.plot(supersteps, sequential_execution_times, marker="o", label="Sequential", color="red")
     plt.plot(supersteps, parallel_execution_times, marker="o", label="Parallel (OpenMP)", color="green")
+    plt.plot(supersteps, parallel_pull_execution_times, marker="o", label="Parallel pull (OpenMP)", color="olive")
     plt.plot(supersteps, distributed_execution_times, marker="o", label="Distributed (OpenMPI)", color="blue")
     plt.plot(supersteps, accelerated_execution_times, marker="o", label="Accelerated (OpenCL)", color="yellow")
+    plt.plot(supersteps, accelerated_pull_execution_times, marker="o", label="Accelerated pull (OpenCL)", color="gold")
+    plt.plot(supersteps, vectorized_execution_times, marker="o", label="Vectorized (SIMD)", color="purple")
 
     plt.xlabel("Number of supersteps")
     plt.ylabel("Execution time (ms)")
@@ -50,21 +480,33 @@ def plot_execution_times(supersteps, sequential_execution_times, parallel_execut
     plt.savefig(os.path.join(OUTPUT_DIR, "plots", "execution_times.png"), dpi=300)
     plt.close()
 
-def plot_speedups(supersteps, sequential_execution_times, parallel_execution_times, distributed_execution_times, accelerated_execution_times):
+def plot_speedups(supersteps, sequential_execution_times, parallel_execution_times, parallel_pull_execution_times, distributed_execution_times, accelerated_execution_times, accelerated_pull_execution_times, vectorized_execution_times):
     parallel_speedups = [
         s / p for s, p in zip(sequential_execution_times, parallel_execution_times)
     ]
+    parallel_pull_speedups = [
+        s / p for s, p in zip(sequential_execution_times, parallel_pull_execution_times)
+    ]
     distributed_speedups = [
         s / d for s, d in zip(sequential_execution_times, distributed_execution_times)
     ]
     accelerated_speedups = [
         s / a for s, a in zip(sequential_execution_times, accelerated_execution_times)
     ]
+    accelerated_pull_speedups = [
+        s / a for s, a in zip(sequential_execution_times, accelerated_pull_execution_times)
+    ]
+    vectorized_speedups = [
+        s / v for s, v in zip(sequential_execution_times, vectorized_execution_times)
+    ]
 
     plt.figure()
     plt.plot(supersteps, parallel_speedups, marker="o", label="Parallel (OpenMP)", color="green")
+    plt.plot(supersteps, parallel_pull_speedups, marker="o", label="Parallel pull (OpenMP)", color="olive")
     plt.plot(supersteps, distributed_speedups, marker="o", label="Distributed (OpenMPI)", color="blue")
     plt.plot(supersteps, accelerated_speedups, marker="o", label="Accelerated (OpenCL)", color="yellow")
+    plt.plot(supersteps, accelerated_pull_speedups, marker="o", label="Accelerated pull (OpenCL)", color="gold")
+    plt.plot(supersteps, vectorized_speedups, marker="o", label="Vectorized (SIMD)", color="purple")
 
     plt.xlabel("Number of supersteps")
     plt.ylabel("Speedup")
@@ -77,43 +519,179 @@ def plot_speedups(supersteps, sequential_execution_times, parallel_execution_tim
     plt.close()
 
 def run_tests():
+    # Convert input graph
+    if USE_BINARY_INPUT:
+        run_test(
+            [GRAPH_CONVERTER, TEXT_INPUT, BINARY_INPUT],
+            "Graph conversion"
+        )
+
     # Run sequential tests
     for supersteps in SUPERSTEPS_LIST:
         run_test(
-            [SEQUENTIAL_PAGE_RANK, str(supersteps)],
+            [SEQUENTIAL_PAGE_RANK] + engine_args(supersteps),
             f"Sequential ({supersteps} supersteps)"
         )
 
     # Run parallel tests
     for supersteps in SUPERSTEPS_LIST:
         run_test(
-            [PARALLEL_PAGE_RANK, str(supersteps)],
+            [PARALLEL_PAGE_RANK] + engine_args(supersteps),
             f"Parallel ({supersteps} supersteps)"
         )
 
+    # Run parallel pull tests
+    for supersteps in SUPERSTEPS_LIST:
+        run_test(
+            [PARALLEL_PAGE_RANK] + engine_args(supersteps) + ["--mode", "pull"],
+            f"Parallel pull ({supersteps} supersteps)"
+        )
+
+    # Run parallel tests with degree-aware schedules
+    for schedule in LOOP_SCHEDULES:
+        for supersteps in SUPERSTEPS_LIST:
+            run_test(
+                [PARALLEL_PAGE_RANK] + engine_args(supersteps) + ["--schedule", schedule, "--report-threads"],
+                f"Parallel {schedule} schedule ({supersteps} supersteps)"
+            )
+            run_test(
+                [PARALLEL_PAGE_RANK] + engine_args(supersteps) + ["--mode", "pull", "--schedule", schedule, "--report-threads"],
+                f"Parallel pull {schedule} schedule ({supersteps} supersteps)"
+            )
+
+    # Run the fused superstep
+    if BENCHMARK_FUSED:
+        for supersteps in SUPERSTEPS_LIST:
+            run_test([SEQUENTIAL_PAGE_RANK] + engine_args(supersteps) + ["--fused"], f"Sequential fused ({supersteps} supersteps)")
+            run_test([PARALLEL_PAGE_RANK] + engine_args(supersteps) + ["--fused"], f"Parallel fused ({supersteps} supersteps)")
+            run_test([PARALLEL_PAGE_RANK] + engine_args(supersteps) + ["--mode", "pull", "--fused"], f"Parallel pull fused ({supersteps} supersteps)")
+
+    # Run the sequential engine with a sum combiner
+    if BENCHMARK_COMBINER:
+        for supersteps in SUPERSTEPS_LIST:
+            run_test([SEQUENTIAL_PAGE_RANK] + engine_args(supersteps) + ["--combine"], f"Sequential combined ({supersteps} supersteps)")
+        report_combiner()
+
+    # Run delta-PageRank; every threshold writes the same file, so report each
+    if DELTA_THRESHOLDS:
+        if DELTA_SUPERSTEPS not in SUPERSTEPS_LIST:
+            run_test([SEQUENTIAL_PAGE_RANK] + engine_args(DELTA_SUPERSTEPS), f"Sequential ({DELTA_SUPERSTEPS} supersteps)")
+            run_test([PARALLEL_PAGE_RANK] + engine_args(DELTA_SUPERSTEPS), f"Parallel ({DELTA_SUPERSTEPS} supersteps)")
+        for threshold in DELTA_THRESHOLDS:
+            delta_args = engine_args(DELTA_SUPERSTEPS) + ["--delta", str(threshold)]
+            run_test([SEQUENTIAL_PAGE_RANK] + delta_args, f"Sequential delta {threshold:g} ({DELTA_SUPERSTEPS} supersteps)")
+            run_test([PARALLEL_PAGE_RANK] + delta_args, f"Parallel delta {threshold:g} ({DELTA_SUPERSTEPS} supersteps)")
+            report_delta(threshold)
+
+    # Run the vertex programs of the Pregel runtime
+    for backend in PREGEL_BACKENDS:
+        for supersteps in SUPERSTEPS_LIST:
+            run_test(
+                pregel_command(backend) + engine_args(supersteps) + pregel_args(backend),
+                f"Pregel {backend} PageRank ({supersteps} supersteps)"
+            )
+        for algorithm in PREGEL_ALGORITHMS:
+            run_test(
+                pregel_command(backend) + engine_args(PREGEL_MAX_SUPERSTEPS) + pregel_args(backend) + ["--algorithm", algorithm],
+                f"Pregel {backend} {algorithm}"
+            )
+
+    # Run parallel NUMA mode on a growing number of nodes
+    if NUMA_NODES > 0 and NUMA_SUPERSTEPS not in SUPERSTEPS_LIST:
+        run_test([PARALLEL_PAGE_RANK] + engine_args(NUMA_SUPERSTEPS), f"Parallel ({NUMA_SUPERSTEPS} supersteps)")
+    for nodes in range(1, NUMA_NODES + 1):
+        run_test(
+            [PARALLEL_PAGE_RANK] + engine_args(NUMA_SUPERSTEPS) + ["--numa-nodes", str(nodes)],
+            f"Parallel NUMA ({NUMA_SUPERSTEPS} supersteps, {nodes} nodes)"
+        )
+
     # Run distributed tests
     for supersteps in SUPERSTEPS_LIST:
         run_test(
-            ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), DISTRIBUTED_PAGE_RANK, str(supersteps)],
-            f"Distributed ({supersteps} supersteps, {MPI_PROCESSES} processes)"
+            ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), "--bind-to", "none", DISTRIBUTED_PAGE_RANK]
+            + engine_args(supersteps) + ["--partition", PARTITION_STRATEGY, "--threads", str(THREADS_PER_PROCESS)],
+            f"Distributed ({supersteps} supersteps, {MPI_PROCESSES} processes x {THREADS_PER_PROCESS} threads, {PARTITION_STRATEGY} partition)"
         )
 
     # Run accelerated tests
     for supersteps in SUPERSTEPS_LIST:
         run_test(
-            [ACCELERATED_PAGE_RANK, str(supersteps)],
+            [ACCELERATED_PAGE_RANK] + engine_args(supersteps),
             f"Accelerated ({supersteps} supersteps)"
         )
 
+    # Run accelerated pull tests
+    for supersteps in SUPERSTEPS_LIST:
+        run_test(
+            [ACCELERATED_PAGE_RANK] + engine_args(supersteps) + ["--mode", "pull"],
+            f"Accelerated pull ({supersteps} supersteps)"
+        )
+
+    # Run vectorized tests
+    for supersteps in SUPERSTEPS_LIST:
+        run_test(
+            [VECTORIZED_PAGE_RANK] + engine_args(supersteps),
+            f"Vectorized ({supersteps} supersteps)"
+        )
+
+    # Run the shared memory engines on reordered graphs
+    for order in REORDER_STRATEGIES:
+        reorder_args = engine_args(REORDER_SUPERSTEPS) + ["--reorder", order]
+        run_test([SEQUENTIAL_PAGE_RANK] + reorder_args, f"Sequential {order} order ({REORDER_SUPERSTEPS} supersteps)")
+        run_test([PARALLEL_PAGE_RANK] + reorder_args, f"Parallel {order} order ({REORDER_SUPERSTEPS} supersteps)")
+        run_test([PARALLEL_PAGE_RANK] + reorder_args + ["--mode", "pull"], f"Parallel pull {order} order ({REORDER_SUPERSTEPS} supersteps)")
+        run_test([VECTORIZED_PAGE_RANK] + reorder_args, f"Vectorized {order} order ({REORDER_SUPERSTEPS} supersteps)")
+    if REORDER_STRATEGIES:
+        for prefix in ["sequential", "parallel", "parallel_pull", "vectorized"]:
+            report_reordering(prefix)
+
+    # Run single precision tests and compare them with the double precision runs
+    if VALIDATE_FLOAT_PRECISION:
+        float_args = engine_args(PRECISION_SUPERSTEPS) + ["--precision", "float"]
+        run_test([SEQUENTIAL_PAGE_RANK] + float_args, f"Sequential float ({PRECISION_SUPERSTEPS} supersteps)")
+        run_test([PARALLEL_PAGE_RANK] + float_args, f"Parallel float ({PRECISION_SUPERSTEPS} supersteps)")
+        run_test([PARALLEL_PAGE_RANK] + float_args + ["--mode", "pull"], f"Parallel pull float ({PRECISION_SUPERSTEPS} supersteps)")
+        run_test(
+            ["mpiexec", "--allow-run-as-root", "-n", str(MPI_PROCESSES), "--bind-to", "none", DISTRIBUTED_PAGE_RANK]
+            + float_args + ["--partition", PARTITION_STRATEGY, "--threads", str(THREADS_PER_PROCESS)],
+            f"Distributed float ({PRECISION_SUPERSTEPS} supersteps)"
+        )
+        run_test([ACCELERATED_PAGE_RANK] + float_args, f"Accelerated float ({PRECISION_SUPERSTEPS} supersteps)")
+        run_test([ACCELERATED_PAGE_RANK] + float_args + ["--mode", "pull"], f"Accelerated pull float ({PRECISION_SUPERSTEPS} supersteps)")
+        run_test([VECTORIZED_PAGE_RANK] + float_args, f"Vectorized float ({PRECISION_SUPERSTEPS} supersteps)")
+
+        for prefix in ["sequential", "parallel", "parallel_pull", "distributed", "accelerated", "accelerated_pull", "vectorized"]:
+            validate_precision(prefix)
+
     # Collect execution times
     sequential_execution_times = collect_execution_times("sequential")
     parallel_execution_times = collect_execution_times("parallel")
+    parallel_pull_execution_times = collect_execution_times("parallel_pull")
     distributed_execution_times = collect_execution_times("distributed")
     accelerated_execution_times = collect_execution_times("accelerated")
+    accelerated_pull_execution_times = collect_execution_times("accelerated_pull")
+    vectorized_execution_times = collect_execution_times("vectorized")
 
     # Generate plots
-    plot_execution_times(SUPERSTEPS_LIST, sequential_execution_times, parallel_execution_times, distributed_execution_times, accelerated_execution_times)
-    plot_speedups(SUPERSTEPS_LIST, sequential_execution_times, parallel_execution_times, distributed_execution_times, accelerated_execution_times)
+    plot_execution_times(SUPERSTEPS_LIST, sequential_execution_times, parallel_execution_times, parallel_pull_execution_times, distributed_execution_times, accelerated_execution_times, accelerated_pull_execution_times, vectorized_execution_times)
+    plot_speedups(SUPERSTEPS_LIST, sequential_execution_times, parallel_execution_times, parallel_pull_execution_times, distributed_execution_times, accelerated_execution_times, accelerated_pull_execution_times, vectorized_execution_times)
+    if LOOP_SCHEDULES:
+        plot_schedules(SUPERSTEPS_LIST)
+    if BENCHMARK_FUSED:
+        plot_fused(SUPERSTEPS_LIST)
+    if PREGEL_BACKENDS:
+        plot_pregel(SUPERSTEPS_LIST)
+    if NUMA_NODES > 0:
+        plot_numa_scaling()
+
+    # Async, checkpoint and parity runs after everything that reads the outputs
+    # they may overwrite
+    if ASYNC_MODES:
+        benchmark_async()
+    if CHECKPOINT_INTERVAL > 0:
+        benchmark_checkpoints()
+    if PREGEL_BACKENDS and not check_pregel_parity():
+        raise SystemExit("Pregel parity check FAILED")
 
 if __name__ == "__main__":
     run_tests()
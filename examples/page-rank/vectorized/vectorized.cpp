@@ -0,0 +1,510 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include <immintrin.h>
+
+#include "../common/checkpoint.h"
+#include "../common/graph.h"
+#include "../common/loader.h"
+#include "../common/reorder.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const double DAMPING = 0.85;
+
+// Used when the L2 size cannot be queried
+const long DEFAULT_L2_BYTES = 256 * 1024;
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+SimdLevel detectSimdLevel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SIMD_AVX2;
+    }
+    return SIMD_SCALAR;
+}
+
+SimdLevel parseSimdLevel(const string& name) {
+    if (name == "scalar") {
+        return SIMD_SCALAR;
+    } else if (name == "avx2") {
+        return SIMD_AVX2;
+    }
+    return SIMD_AVX512;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "AVX2";
+        case SIMD_AVX512: return "AVX-512";
+        default: return "scalar";
+    }
+}
+
+// In-edges restricted to the sources firstSource .. lastSource - 1, so the
+// slice of contributions one block gathers from stays in L2. Only rows with
+// at least one in-edge from the block are kept; sources keep global ids.
+struct ColumnBlock {
+    int firstSource = 0;
+    int lastSource = 0;
+    vector<int> rows;
+    vector<int> offsets;
+    vector<int> sources;
+};
+
+// Splits the transposed graph into column blocks of blockSize sources. Rows
+// are visited in order and in-edges are sorted by source, so every block is
+// a CSR over its rows with sorted (gather friendly) source indices.
+void buildColumnBlocks(const Graph& graph, int blockSize, vector<ColumnBlock>& blocks) {
+    int n = graph.n;
+    int blockCount = max(1, (n + blockSize - 1) / blockSize);
+
+    blocks.assign(blockCount, ColumnBlock());
+    for (int b = 0; b < blockCount; ++b) {
+        blocks[b].firstSource = min(b * blockSize, n);
+        blocks[b].lastSource = min((b + 1) * blockSize, n);
+        blocks[b].offsets.push_back(0);
+    }
+
+    vector<int> rowSources;
+    for (int v = 0; v < n; ++v) {
+        rowSources.assign(graph.inEdges.begin() + graph.inOffsets[v], graph.inEdges.begin() + graph.inOffsets[v + 1]);
+        sort(rowSources.begin(), rowSources.end());
+
+        for (int u : rowSources) {
+            ColumnBlock& block = blocks[u / blockSize];
+            if (block.rows.empty() || block.rows.back() != v) {
+                if (!block.rows.empty()) {
+                    block.offsets.push_back(block.sources.size());
+                }
+                block.rows.push_back(v);
+            }
+            block.sources.push_back(u);
+        }
+    }
+
+    for (ColumnBlock& block : blocks) {
+        if (!block.rows.empty()) {
+            block.offsets.push_back(block.sources.size());
+        }
+    }
+}
+
+// Vertices per column block such that a block's contributions take half of
+// the L2, leaving the other half for the streamed rows and sources
+int columnBlockSize(size_t rankBytes) {
+    long l2Bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2Bytes <= 0) {
+        l2Bytes = DEFAULT_L2_BYTES;
+    }
+    return max(1024L, l2Bytes / 2 / (long)rankBytes);
+}
+
+// contributions[u] = rank[u] / outdeg(u), returns the dangling mass. The
+// inverse degree of a dangling vertex is 0 and its mask entry is 1.
+template <typename Rank>
+ALWAYS_INLINE double scatterContributions(const Rank* pageRanks, const Rank* inverseOutDegrees, const Rank* danglingMask, Rank* contributions, int n) {
+    double danglingMass = 0.0;
+    #pragma omp simd reduction(+:danglingMass)
+    for (int u = 0; u < n; ++u) {
+        contributions[u] = pageRanks[u] * inverseOutDegrees[u];
+        danglingMass += double(pageRanks[u] * danglingMask[u]);
+    }
+    return danglingMass;
+}
+
+// next[v] = (1-d)/n + danglingShare + d * inbox[v], returns the residual
+template <typename Rank>
+ALWAYS_INLINE double updateRanks(const Rank* pageRanks, const double* inbox, double base, Rank* nextPageRanks, int n) {
+    double residual = 0.0;
+    #pragma omp simd reduction(+:residual)
+    for (int v = 0; v < n; ++v) {
+        Rank next = Rank(base + DAMPING * inbox[v]);
+        nextPageRanks[v] = next;
+        residual += fabs(double(next) - double(pageRanks[v]));
+    }
+    return residual;
+}
+
+template <typename Rank>
+void spmvScalar(const ColumnBlock& block, const Rank* contributions, double* outbox) {
+    for (size_t r = 0; r < block.rows.size(); ++r) {
+        double sum = 0.0;
+        for (int i = block.offsets[r]; i < block.offsets[r + 1]; ++i) {
+            sum += contributions[block.sources[i]];
+        }
+        outbox[block.rows[r]] += sum;
+    }
+}
+
+TARGET_AVX2 ALWAYS_INLINE double horizontalSum(__m256d acc) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+// The gathers are the masked forms with a zeroed source and every lane
+// enabled: the plain ones start from an undefined register, which GCC
+// reports as maybe uninitialized
+TARGET_AVX2 void spmvAvx2(const ColumnBlock& block, const double* contributions, double* outbox) {
+    const int* sources = block.sources.data();
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (size_t r = 0; r < block.rows.size(); ++r) {
+        int i = block.offsets[r];
+        int end = block.offsets[r + 1];
+
+        __m256d acc = _mm256_setzero_pd();
+        for (; i + 4 <= end; i += 4) {
+            __m128i indices = _mm_loadu_si128((const __m128i*)(sources + i));
+            acc = _mm256_add_pd(acc, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), contributions, indices, allLanes, 8));
+        }
+        double sum = horizontalSum(acc);
+
+        for (; i < end; ++i) {
+            sum += contributions[sources[i]];
+        }
+        outbox[block.rows[r]] += sum;
+    }
+}
+
+TARGET_AVX2 void spmvAvx2(const ColumnBlock& block, const float* contributions, double* outbox) {
+    const int* sources = block.sources.data();
+    const __m256 allLanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t r = 0; r < block.rows.size(); ++r) {
+        int i = block.offsets[r];
+        int end = block.offsets[r + 1];
+
+        // Gather 8 floats, accumulate in two double lanes of 4
+        __m256d low = _mm256_setzero_pd();
+        __m256d high = _mm256_setzero_pd();
+        for (; i + 8 <= end; i += 8) {
+            __m256i indices = _mm256_loadu_si256((const __m256i*)(sources + i));
+            __m256 gathered = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), contributions, indices, allLanes, 4);
+            low = _mm256_add_pd(low, _mm256_cvtps_pd(_mm256_castps256_ps128(gathered)));
+            high = _mm256_add_pd(high, _mm256_cvtps_pd(_mm256_extractf128_ps(gathered, 1)));
+        }
+        double sum = horizontalSum(_mm256_add_pd(low, high));
+
+        for (; i < end; ++i) {
+            sum += contributions[sources[i]];
+        }
+        outbox[block.rows[r]] += sum;
+    }
+}
+
+// Half of a 512-bit vector. This and the conversions below are zero masked
+// for the same reason as the gathers: GCC builds the unmasked 512 to 256-bit
+// casts, extracts and reductions on an undefined register too.
+TARGET_AVX512 ALWAYS_INLINE __m256d halfOf(__m512d v, const int upper) {
+    return upper ? _mm512_maskz_extractf64x4_pd((__mmask8)0xF, v, 1) : _mm512_maskz_extractf64x4_pd((__mmask8)0xF, v, 0);
+}
+
+TARGET_AVX512 ALWAYS_INLINE double horizontalSum(__m512d acc) {
+    return horizontalSum(_mm256_add_pd(halfOf(acc, 0), halfOf(acc, 1)));
+}
+
+// Adds the low and high 8 floats of gathered to low and high as doubles
+TARGET_AVX512 ALWAYS_INLINE void addWidened(__m512 gathered, __m512d& low, __m512d& high) {
+    __m512d bits = _mm512_castps_pd(gathered);
+    low = _mm512_add_pd(low, _mm512_maskz_cvtps_pd((__mmask8)0xFF, _mm256_castpd_ps(halfOf(bits, 0))));
+    high = _mm512_add_pd(high, _mm512_maskz_cvtps_pd((__mmask8)0xFF, _mm256_castpd_ps(halfOf(bits, 1))));
+}
+
+TARGET_AVX512 void spmvAvx512(const ColumnBlock& block, const double* contributions, double* outbox) {
+    const int* sources = block.sources.data();
+    for (size_t r = 0; r < block.rows.size(); ++r) {
+        int i = block.offsets[r];
+        int end = block.offsets[r + 1];
+
+        __m512d acc = _mm512_setzero_pd();
+        for (; i + 8 <= end; i += 8) {
+            __m256i indices = _mm256_loadu_si256((const __m256i*)(sources + i));
+            acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8)0xFF, indices, contributions, 8));
+        }
+        // Masked gather for the remainder of the row
+        int rest = end - i;
+        if (rest > 0) {
+            __mmask8 mask = (__mmask8)((1u << rest) - 1);
+            __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(rest), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            __m256i indices = _mm256_maskload_epi32(sources + i, lanes);
+            acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, indices, contributions, 8));
+        }
+        outbox[block.rows[r]] += horizontalSum(acc);
+    }
+}
+
+TARGET_AVX512 void spmvAvx512(const ColumnBlock& block, const float* contributions, double* outbox) {
+    const int* sources = block.sources.data();
+    for (size_t r = 0; r < block.rows.size(); ++r) {
+        int i = block.offsets[r];
+        int end = block.offsets[r + 1];
+
+        // Gather 16 floats, accumulate in two double lanes of 8
+        __m512d low = _mm512_setzero_pd();
+        __m512d high = _mm512_setzero_pd();
+        for (; i + 16 <= end; i += 16) {
+            __m512i indices = _mm512_loadu_si512((const void*)(sources + i));
+            __m512 gathered = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), (__mmask16)0xFFFF, indices, contributions, 4);
+            addWidened(gathered, low, high);
+        }
+        int rest = end - i;
+        if (rest > 0) {
+            __mmask16 mask = (__mmask16)((1u << rest) - 1);
+            __m512i indices = _mm512_maskz_loadu_epi32(mask, sources + i);
+            __m512 gathered = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, indices, contributions, 4);
+            addWidened(gathered, low, high);
+        }
+        outbox[block.rows[r]] += horizontalSum(_mm512_add_pd(low, high));
+    }
+}
+
+// The three superstep loops for one instruction set; the simd loops are
+// inlined into target specific wrappers so they are compiled for it too
+template <typename Rank>
+struct SimdKernels {
+    double (*scatter)(const Rank*, const Rank*, const Rank*, Rank*, int);
+    double (*update)(const Rank*, const double*, double, Rank*, int);
+    void (*spmv)(const ColumnBlock&, const Rank*, double*);
+};
+
+template <typename Rank>
+double scatterScalar(const Rank* pageRanks, const Rank* inverseOutDegrees, const Rank* danglingMask, Rank* contributions, int n) {
+    return scatterContributions(pageRanks, inverseOutDegrees, danglingMask, contributions, n);
+}
+
+template <typename Rank>
+TARGET_AVX2 double scatterAvx2(const Rank* pageRanks, const Rank* inverseOutDegrees, const Rank* danglingMask, Rank* contributions, int n) {
+    return scatterContributions(pageRanks, inverseOutDegrees, danglingMask, contributions, n);
+}
+
+template <typename Rank>
+TARGET_AVX512 double scatterAvx512(const Rank* pageRanks, const Rank* inverseOutDegrees, const Rank* danglingMask, Rank* contributions, int n) {
+    return scatterContributions(pageRanks, inverseOutDegrees, danglingMask, contributions, n);
+}
+
+template <typename Rank>
+double updateScalar(const Rank* pageRanks, const double* inbox, double base, Rank* nextPageRanks, int n) {
+    return updateRanks(pageRanks, inbox, base, nextPageRanks, n);
+}
+
+template <typename Rank>
+TARGET_AVX2 double updateAvx2(const Rank* pageRanks, const double* inbox, double base, Rank* nextPageRanks, int n) {
+    return updateRanks(pageRanks, inbox, base, nextPageRanks, n);
+}
+
+template <typename Rank>
+TARGET_AVX512 double updateAvx512(const Rank* pageRanks, const double* inbox, double base, Rank* nextPageRanks, int n) {
+    return updateRanks(pageRanks, inbox, base, nextPageRanks, n);
+}
+
+template <typename Rank>
+SimdKernels<Rank> selectKernels(SimdLevel level) {
+    SimdKernels<Rank> kernels;
+    if (level == SIMD_AVX512) {
+        kernels.scatter = scatterAvx512<Rank>;
+        kernels.update = updateAvx512<Rank>;
+        kernels.spmv = spmvAvx512;
+    } else if (level == SIMD_AVX2) {
+        kernels.scatter = scatterAvx2<Rank>;
+        kernels.update = updateAvx2<Rank>;
+        kernels.spmv = spmvAvx2;
+    } else {
+        kernels.scatter = scatterScalar<Rank>;
+        kernels.update = updateScalar<Rank>;
+        kernels.spmv = spmvScalar<Rank>;
+    }
+    return kernels;
+}
+
+void generateOutput(const string& filename, const vector<double>& pageRanks, const PageNames& pageNames, long long executionTime, int supersteps, double residual, long long loadTime, long long reorderTime) {
+    ofstream outFile(filename);
+
+    outFile << executionTime << " " << supersteps << " " << residual << " " << loadTime << " " << reorderTime << endl;
+    for (size_t i = 0; i < pageRanks.size(); ++i) {
+        outFile << pageNames[i] << " " << pageRanks[i] << endl;
+    }
+
+    outFile.close();
+}
+
+// Same supersteps as the sequential engine, written as a pull SpMV: the
+// inbox of step k + 1 is the transposed adjacency times the contributions
+// of step k. Ranks and contributions are stored as Rank (float or double),
+// the inbox and all reductions are accumulated in double. A checkpoint holds
+// the ranks and the inbox.
+template <typename Rank>
+vector<Rank> rankPages(const Graph& graph, const vector<ColumnBlock>& blocks, SimdLevel level, const CheckpointOptions& checkpoints, int maxSupersteps, double epsilon, int& supersteps, double& residual) {
+    int n = graph.n;
+    SimdKernels<Rank> kernels = selectKernels<Rank>(level);
+
+    vector<Rank> inverseOutDegrees(n, 0.0);
+    vector<Rank> danglingMask(n, 0.0);
+    for (int v = 0; v < n; ++v) {
+        int degree = graph.outDegree(v);
+        if (degree > 0) {
+            inverseOutDegrees[v] = 1.0 / degree;
+        } else {
+            danglingMask[v] = 1.0;
+        }
+    }
+
+    vector<Rank> pageRanks(n, 1.0 / n);
+    vector<Rank> nextPageRanks(n, 0.0);
+    vector<Rank> contributions(n, 0.0);
+    vector<double> inbox(n, 0.0);
+    vector<double> outbox(n, 0.0);
+
+    // Every vertex with out-edges sends in every superstep
+    bool messagesSent = graph.m > 0;
+    bool converged = false;
+
+    supersteps = 0;
+    residual = 0.0;
+
+    if (checkpoints.resume) {
+        Checkpoint checkpoint;
+        readCheckpoint(checkpoints.path, n, 2, checkpoint);
+        copyFromCheckpoint(checkpoint.vector(0), n, pageRanks.data());
+        copyFromCheckpoint(checkpoint.vector(1), n, inbox.data());
+        supersteps = checkpoint.header.superstep;
+        residual = checkpoint.header.scalars[0];
+        converged = supersteps > 0 && residual < epsilon;
+    }
+    CheckpointWriter checkpointWriter(checkpoints, n, 2);
+
+    for (int step = supersteps; step < maxSupersteps && messagesSent && !converged; ++step) {
+        double danglingMass = kernels.scatter(pageRanks.data(), inverseOutDegrees.data(), danglingMask.data(), contributions.data(), n);
+        double danglingShare = DAMPING * danglingMass / n;
+
+        residual = kernels.update(pageRanks.data(), inbox.data(), (1.0 - DAMPING) / n + danglingShare, nextPageRanks.data(), n);
+
+        fill(outbox.begin(), outbox.end(), 0.0);
+        for (const ColumnBlock& block : blocks) {
+            kernels.spmv(block, contributions.data(), outbox.data());
+        }
+
+        inbox.swap(outbox);
+        pageRanks.swap(nextPageRanks);
+
+        supersteps = step + 1;
+        converged = residual < epsilon;
+
+        if (checkpoints.due(supersteps)) {
+            Checkpoint& checkpoint = checkpointWriter.beginSnapshot(supersteps);
+            copyToCheckpoint(pageRanks.data(), n, checkpoint.vector(0));
+            copyToCheckpoint(inbox.data(), n, checkpoint.vector(1));
+            checkpoint.header.scalars[0] = residual;
+            checkpointWriter.commitSnapshot();
+        }
+    }
+    checkpointWriter.finish();
+
+    return pageRanks;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "MAX_SUPERSTEPS is missing..." << endl << "Usage: " << argv[0] << " <MAX_SUPERSTEPS> [--epsilon <EPSILON>] [--input <GRAPH_FILE>] [--precision double|float] [--reorder degree|rcm|gorder] [--simd scalar|avx2|avx512] [--block-size <VERTICES>] [--checkpoint <SUPERSTEPS>] [--checkpoint-file <PATH>] [--resume]" << endl;
+        return 1;
+    }
+    int maxSupersteps = atoi(argv[1]);
+
+    string inputFile = "/app/input/graph.txt";
+    double epsilon = 0.0;
+    bool singlePrecision = false;
+    VertexOrder vertexOrder = ORIGINAL_ORDER;
+    SimdLevel level = detectSimdLevel();
+    int blockSize = 0;
+    CheckpointOptions checkpoints;
+    checkpoints.path = "/app/output/vectorized.checkpoint";
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--epsilon" && i + 1 < argc) {
+            epsilon = atof(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "--precision" && i + 1 < argc) {
+            singlePrecision = string(argv[++i]) == "float";
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            vertexOrder = parseVertexOrder(argv[++i]);
+        } else if (arg == "--simd" && i + 1 < argc) {
+            // Can only lower the level the CPU supports
+            level = min(level, parseSimdLevel(argv[++i]));
+        } else if (arg == "--block-size" && i + 1 < argc) {
+            blockSize = atoi(argv[++i]);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoints.interval = max(0, atoi(argv[++i]));
+        } else if (arg == "--checkpoint-file" && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (arg == "--resume") {
+            checkpoints.resume = true;
+        }
+    }
+
+    PageNames pageNames;
+    Graph graph;
+
+    auto loadStart = high_resolution_clock::now();
+    loadGraph(inputFile, pageNames, graph);
+
+    // Relabel for locality, ranks are mapped back to the original ids below
+    auto reorderStart = high_resolution_clock::now();
+    vector<int> newIds;
+    if (vertexOrder != ORIGINAL_ORDER) {
+        newIds = reorderGraph(graph, vertexOrder);
+    }
+    long long reorderTime = duration_cast<milliseconds>(high_resolution_clock::now() - reorderStart).count();
+    buildInEdges(graph);
+
+    if (blockSize <= 0) {
+        blockSize = columnBlockSize(singlePrecision ? sizeof(float) : sizeof(double));
+    }
+    vector<ColumnBlock> blocks;
+    buildColumnBlocks(graph, blockSize, blocks);
+    auto loadEnd = high_resolution_clock::now();
+    long long loadTime = duration_cast<milliseconds>(loadEnd - loadStart).count() - reorderTime;
+
+    cout << "Using " << simdLevelName(level) << " kernels, " << blocks.size() << " column blocks of " << blockSize << " vertices" << endl;
+
+    int supersteps;
+    double residual;
+
+    auto start = high_resolution_clock::now();
+    vector<double> pageRanks;
+    if (singlePrecision) {
+        vector<float> singlePageRanks = rankPages<float>(graph, blocks, level, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+        pageRanks.assign(singlePageRanks.begin(), singlePageRanks.end());
+    } else {
+        pageRanks = rankPages<double>(graph, blocks, level, checkpoints, maxSupersteps, epsilon, supersteps, residual);
+    }
+    auto end = high_resolution_clock::now();
+    long long executionTime =duration_cast<milliseconds>(end - start).count();
+
+    if (vertexOrder != ORIGINAL_ORDER) {
+        auto restoreStart = high_resolution_clock::now();
+        pageRanks = restoreOrder(pageRanks, newIds);
+        reorderTime += duration_cast<milliseconds>(high_resolution_clock::now() - restoreStart).count();
+        cout << "Reordered vertices (" << vertexOrderName(vertexOrder) << ") in " << reorderTime << " ms" << endl;
+    }
+
+    string outputFile = "/app/output/vectorized_" + string(singlePrecision ? "float_" : "") + (vertexOrder != ORIGINAL_ORDER ? string(vertexOrderName(vertexOrder)) + "_" : string()) + to_string(maxSupersteps) + ".txt";
+    generateOutput(outputFile, pageRanks, pageNames, executionTime, supersteps, residual, loadTime, reorderTime);
+
+    return 0;
+}